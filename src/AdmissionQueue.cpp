@@ -0,0 +1,177 @@
+/*
+ * AdmissionQueue.cpp
+ * see AdmissionQueue.h for details
+ */
+
+#include <stdexcept>
+#include <algorithm>
+#include <limits.h>
+#include "AdmissionQueue.h"
+
+using namespace std;
+
+const long AdmissionQueue::NONE = LONG_MAX;
+
+AdmissionQueue::AdmissionQueue(int maxResources, Policy policy, int maxBypass) {
+	if (maxResources < 0) {
+		throw logic_error("AdmissionQueue: resources cannot be negative");
+	}
+
+	this->policy    = policy;
+	this->maxBypass = maxBypass;
+	bypassed  = 0;
+	nextSeq   = 0;
+	sizeCount = 0;
+
+	for (leaves = 1; leaves < maxResources + 1; leaves *= 2) {}
+
+	buckets.resize(maxResources + 1);
+	tree.resize(2 * leaves, NONE);
+}
+
+void AdmissionQueue::push(Job *j) {
+	int r = j->get_resources();
+
+	j->admitSeq = nextSeq++;
+	buckets[r].push(j);
+	sizeCount++;
+
+	if (buckets[r].size() == 1) {update(r);}
+}
+
+void AdmissionQueue::remove(Job *j) {
+	if (j->get_queue() != &buckets[j->get_resources()]) {
+		throw runtime_error("AdmissionQueue: job is not waiting on memory");
+	}
+
+	take(j);
+}
+
+bool AdmissionQueue::empty() {
+	return sizeCount == 0;
+}
+
+int AdmissionQueue::size() {
+	return sizeCount;
+}
+
+AdmissionQueue::Policy AdmissionQueue::get_policy() {
+	return policy;
+}
+
+//O(n log n), but only a checkpoint (in its own process, see Scheduler::checkpoint())
+//ever does this
+void AdmissionQueue::collect(vector<Job*> &out) {
+	size_t first = out.size();
+
+	for (unsigned r = 0; r < buckets.size(); r++) {
+		for (Job *j = buckets[r].empty() ? NULL : buckets[r].front(); j != NULL;
+			 j = buckets[r].next(j)) {
+			out.push_back(j);
+		}
+	}
+	sort(out.begin() + first, out.end(), admitted_before);
+}
+
+int AdmissionQueue::get_bypassed() {
+	return bypassed;
+}
+
+void AdmissionQueue::set_bypassed(int bypassed) {
+	this->bypassed = bypassed;
+}
+
+//The head is the oldest job, at the front of bucket oldest_in(everything). It is always
+//allowed in if it fits; anything else counts as bypassing it
+Job *AdmissionQueue::pop_fitting(int freeMemory) {
+	int head = oldest_in(buckets.size() - 1);
+	int hi   = freeMemory < (int) buckets.size() ? freeMemory : buckets.size() - 1;
+	int b;
+
+	if (head == -1 || hi < 0) {return NULL;}
+
+	if (policy == FIFO || (maxBypass >= 0 && bypassed >= maxBypass)) {
+		b = head <= hi ? head : -1;
+	} else if (policy == FIRST_FIT) {
+		b = oldest_in(hi);
+	} else {
+		b = largest_in(hi);
+	}
+
+	if (b == -1) {return NULL;}
+
+	Job *j = buckets[b].front();
+	if (b != head) {bypassed++;}
+
+	take(j);
+	return j;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+void AdmissionQueue::take(Job *j) {
+	int r = j->get_resources();
+	bool wasFront = buckets[r].front() == j;
+
+	if (j->admitSeq == tree[1]) {bypassed = 0;} //the head is leaving; the next is new
+
+	buckets[r].remove(j);
+	sizeCount--;
+
+	if (wasFront) {update(r);}
+}
+
+void AdmissionQueue::update(int bucket) {
+	int node = leaves + bucket;
+
+	tree[node] = buckets[bucket].empty() ? NONE : buckets[bucket].front()->admitSeq;
+
+	for (node /= 2; node >= 1; node /= 2) {
+		tree[node] = tree[2 * node] < tree[2 * node + 1] ? tree[2 * node]
+														 : tree[2 * node + 1];
+	}
+}
+
+//Bottom-up range minimum over leaves [0, hi], remembering which node held it, then back
+//down from that node to its leaf (arrival numbers are unique, so the path is too)
+int AdmissionQueue::oldest_in(int hi) {
+	long best = NONE;
+	int  node = -1;
+
+	for (int l = leaves, r = leaves + hi + 1; l < r; l /= 2, r /= 2) {
+		if (l & 1) {
+			if (tree[l] < best) {best = tree[l]; node = l;}
+			l++;
+		}
+		if (r & 1) {
+			r--;
+			if (tree[r] < best) {best = tree[r]; node = r;}
+		}
+	}
+
+	if (node == -1) {return -1;}
+
+	while (node < leaves) {
+		node = tree[2 * node] == best ? 2 * node : 2 * node + 1;
+	}
+	return node - leaves;
+}
+
+//Climb from leaf hi; the first left sibling with anything under it holds the answer,
+//which is then its rightmost non-empty leaf
+int AdmissionQueue::largest_in(int hi) {
+	int node = leaves + hi;
+
+	if (tree[node] != NONE) {return hi;}
+
+	while (node > 1 && !((node & 1) && tree[node - 1] != NONE)) {
+		node /= 2;
+	}
+
+	if (node == 1) {return -1;}
+
+	for (node--; node < leaves; ) {
+		node = tree[2 * node + 1] != NONE ? 2 * node + 1 : 2 * node;
+	}
+	return node - leaves;
+}
@@ -0,0 +1,75 @@
+/*
+ * AdmissionQueue
+ *
+ * Jobs that have no dependencies left but are waiting for memory. Which of them gets
+ * admitted next is up to the policy:
+ *
+ * FIFO:	  The oldest job, and nothing else until it fits. One job that needs most of
+ *			  memory blocks every small job behind it (the "convoy effect").
+ * FIRST_FIT: The oldest job that fits in the memory that is free right now.
+ * BEST_FIT:  The biggest job that fits (the oldest of those if there is a tie), leaving
+ *			  as little memory idle as possible.
+ *
+ * Both backfilling policies can starve a big job at the head of the line forever, so the
+ * head can be given a reservation: after maxBypass jobs have been admitted ahead of it,
+ * nothing else is admitted until it is (maxBypass < 0 means no reservation).
+ *
+ * Jobs are kept in one FIFO JobQueue per resource size, and a segment tree over the sizes
+ * holds the arrival number of the front of every bucket (the oldest job of that size).
+ * The oldest job overall, the oldest job no bigger than some size, and the biggest job no
+ * bigger than some size are all O(log maxResources) walks of the tree, however many jobs
+ * are waiting. Removing any job (e.g. a killed one) is O(log maxResources) too.
+ */
+
+#ifndef ADMISSIONQUEUE_H_
+#define ADMISSIONQUEUE_H_
+
+#include <vector>
+#include "Job.h"
+#include "JobQueue.h"
+
+class AdmissionQueue {
+	public:
+		enum Policy {FIFO, FIRST_FIT, BEST_FIT};
+
+		 AdmissionQueue(int maxResources, Policy policy, int maxBypass);
+
+		void push(Job *j);
+		void remove(Job *j); //j must be in this queue
+		bool empty();
+		int  size();
+
+		//Remove and return the next job to admit given freeMemory, or NULL if the policy
+		//does not admit anything right now
+		Job *pop_fitting(int freeMemory);
+
+		Policy get_policy();
+
+		//For checkpoints: append every waiting job to out, oldest first, and the number of
+		//jobs admitted ahead of the current head (which pushing them in that order into a
+		//new queue does not bring back)
+		void collect(std::vector<Job*> &out);
+		int  get_bypassed();
+		void set_bypassed(int bypassed);
+
+	private:
+		static const long NONE; //tree value of an empty bucket (bigger than any arrival)
+
+		Policy policy;
+		int    maxBypass;
+		int    bypassed;  //jobs admitted ahead of the current head
+		long   nextSeq;   //arrival number for the next push
+		int    sizeCount;
+		int    leaves;    //number of leaves in the tree, a power of two
+
+		std::vector<JobQueue> buckets; //buckets[r]: the waiting jobs using r resources
+		std::vector<long>     tree;    //tree[leaves + r]: arrival of buckets[r].front()
+
+		void update(int bucket);	//refresh a bucket's leaf and its ancestors
+		int  oldest_in(int hi);		//bucket holding the oldest job of size <= hi, or -1
+		int  largest_in(int hi);	//largest non-empty bucket <= hi, or -1
+		void take(Job *j);			//remove j and keep the head's bypass count honest
+		static bool admitted_before(Job *a, Job *b) {return a->admitSeq < b->admitSeq;}
+};
+
+#endif /* ADMISSIONQUEUE_H_ */
@@ -0,0 +1,131 @@
+/*
+ * Checkpoint.cpp
+ * see Checkpoint.h for details
+ */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Checkpoint.h"
+
+using namespace std;
+
+CheckpointWriter::CheckpointWriter() {
+	out    = NULL;
+	failed = false;
+}
+
+CheckpointWriter::~CheckpointWriter() {
+	if (out != NULL) {
+		fclose(out);
+		unlink(tmpPath.c_str());
+	}
+}
+
+bool CheckpointWriter::open(const char *path) {
+	this->path = path;
+	tmpPath    = this->path + ".tmp";
+	failed     = false;
+
+	out = fopen(tmpPath.c_str(), "wb");
+	if (out != NULL) {setvbuf(out, NULL, _IOFBF, BUFFER_BYTES);}
+	return out != NULL;
+}
+
+void CheckpointWriter::put_bytes(const void *bytes, size_t n) {
+	if (n > 0 && fwrite(bytes, n, 1, out) != 1) {failed = true;}
+}
+
+bool CheckpointWriter::close() {
+	if (out == NULL) {return false;}
+
+	failed = fflush(out) != 0 || fsync(fileno(out)) != 0 || failed;
+	failed = fclose(out) != 0 || failed;
+	out    = NULL;
+
+	if (failed || rename(tmpPath.c_str(), path.c_str()) != 0) {
+		unlink(tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+CheckpointReader::CheckpointReader() {
+	data     = NULL;
+	size     = 0;
+	position = 0;
+	overrun  = false;
+}
+
+CheckpointReader::~CheckpointReader() {
+	if (size > 0) {munmap((void *) data, size);}
+}
+
+bool CheckpointReader::open(const char *path) {
+	struct stat st;
+	int file = ::open(path, O_RDONLY);
+
+	if (file < 0) {return false;}
+	if (fstat(file, &st) != 0 || st.st_size == 0) {
+		::close(file);
+		return false;
+	}
+
+	void *m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (m == MAP_FAILED) {return false;}
+
+	madvise(m, st.st_size, MADV_SEQUENTIAL);
+	data = static_cast<const char *>(m);
+	size = st.st_size;
+	return true;
+}
+
+const char *CheckpointReader::get_bytes(size_t n) {
+	if (overrun || n > size - position) {
+		overrun = true;
+		return NULL;
+	}
+	position += n;
+	return data + position - n;
+}
+
+int32_t CheckpointReader::get_int() {
+	int32_t x = 0;
+	const char *p = get_bytes(sizeof(x));
+
+	if (p != NULL) {memcpy(&x, p, sizeof(x));}
+	return x;
+}
+
+int64_t CheckpointReader::get_long() {
+	int64_t x = 0;
+	const char *p = get_bytes(sizeof(x));
+
+	if (p != NULL) {memcpy(&x, p, sizeof(x));}
+	return x;
+}
+
+double CheckpointReader::get_double() {
+	double x = 0;
+	const char *p = get_bytes(sizeof(x));
+
+	if (p != NULL) {memcpy(&x, p, sizeof(x));}
+	return x;
+}
+
+bool CheckpointReader::failed() {
+	return overrun;
+}
+
+bool CheckpointReader::at_end() {
+	return position == size;
+}
+
+size_t CheckpointReader::get_remaining() {
+	return size - position;
+}
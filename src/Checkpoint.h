@@ -0,0 +1,80 @@
+/*
+ * Checkpoint
+ *
+ * The file a Scheduler snapshots its whole state to, and restores it from (see
+ * Scheduler::checkpoint() and restore()). The Scheduler decides what goes in it; these
+ * two only write and read fixed-width values, in the machine's own byte order (a
+ * checkpoint is for restarting on the same kind of machine, not for exchange).
+ *
+ * CheckpointWriter writes to PATH.tmp and only renames it over PATH once everything is
+ * written and synced, so PATH always holds the last complete checkpoint even if writing
+ * the next one dies halfway.
+ *
+ * CheckpointReader maps the whole file and reads through it in place. Reading past the
+ * end returns zeros and sets failed(), so the caller can check once at the end (or
+ * before trusting a count) instead of after every value.
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <string>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+class CheckpointWriter {
+	public:
+		static const size_t BUFFER_BYTES = 1 << 20;
+
+		 CheckpointWriter();
+		~CheckpointWriter(); //discards the file if close() was not called
+
+		bool open(const char *path); //false if PATH.tmp cannot be created
+
+		void put_int   (int32_t x) {put_bytes(&x, sizeof(x));}
+		void put_long  (int64_t x) {put_bytes(&x, sizeof(x));}
+		void put_double(double  x) {put_bytes(&x, sizeof(x));}
+		void put_bytes (const void *bytes, size_t n);
+
+		bool close(); //false if anything could not be written (PATH is left as it was)
+
+	private:
+		FILE *out;
+		bool  failed;
+		std::string path;
+		std::string tmpPath;
+
+		//Not copyable
+		CheckpointWriter(const CheckpointWriter &);
+		CheckpointWriter &operator=(const CheckpointWriter &);
+};
+
+class CheckpointReader {
+	public:
+		 CheckpointReader();
+		~CheckpointReader();
+
+		bool open(const char *path); //false if it cannot be opened or mapped
+
+		int32_t get_int();
+		int64_t get_long();
+		double  get_double();
+		const char *get_bytes(size_t n); //NULL (and failed()) past the end
+
+		bool   failed();
+		bool   at_end();
+		size_t get_remaining(); //bytes not read yet
+
+	private:
+		const char *data;
+		size_t 		size;
+		size_t 		position;
+		bool 		overrun;
+
+		//Not copyable
+		CheckpointReader(const CheckpointReader &);
+		CheckpointReader &operator=(const CheckpointReader &);
+};
+
+#endif /* CHECKPOINT_H_ */
@@ -6,6 +6,9 @@
 
 #include <string>
 #include <iostream>
+#include <chrono>
+#include <stdarg.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <ncurses.h>
 #include "CursesHandler.h"
@@ -13,11 +16,24 @@
 
 using namespace std;
 
-//Calls a variety of NCurses methods to initialize the SharkBatch I/O environment
-CursesHandler::CursesHandler() {
+//Calls a variety of NCurses methods to initialize the SharkBatch I/O environment, then
+//starts the render thread. A headless handler never touches the terminal and every
+//print function becomes a no-op
+CursesHandler::CursesHandler(bool headless) {
+	this->headless = headless;
+	finished 	   = false;
+	currentFeedRow = FEED_ROW;
+	cursorRow 	   = 0;
+	cursorCol 	   = 0;
+	batching 	   = false;
+	inputMode 	   = false;
+	stopping 	   = false;
+	
+	if (headless) {return;}
+	
 	initscr(); //startup ncurses and initialize the stdscr (terminal window object)
 	cbreak(); //disables line buffering
-	timeout(1); //set getch to non-blocking, allowing for "asynchronous" loop breaking
+	timeout(0); //set getch to non-blocking, allowing for "asynchronous" loop breaking
 	curs_set(0); //make the cursor invisible (makes everything look better)
 	echo(); //echo user input to the current location of the cursor
 	
@@ -31,68 +47,206 @@ CursesHandler::CursesHandler() {
 	
 	noecho(); //echo prints user input tot he current location of the cursor. We want to
 			  //start with noecho() by default for the main menu but can turn it on later
-	
-	currentFeedRow = FEED_ROW;
 
 	refresh(); //Syncs the buffer with the stdscr window
+	
+	rows .assign(consoleHeight, "");
+	dirty.assign(consoleHeight, true);
+	shown.assign(consoleHeight, "");
+	
+	renderer = thread(&CursesHandler::render_loop, this);
 }
 
 //The destructor returns the terminal to it's original state (if SharkBatch terminates and
 //there are some messy text wrapping issues in your terminal, it's probably because this
 //destructor was not called at the right time)
 CursesHandler::~CursesHandler() {
+	close();
+}
+
+void CursesHandler::close() {
+	if (headless || finished) {return;}
+	finished = true;
+	
+	{
+		lock_guard<mutex> guard(stopLock);
+		stopping = true;
+	}
+	stopWake.notify_one();
+	renderer.join();
+	draw(); //whatever was printed after the last frame
+	
 	printw("\n"); //puts the command line cursor beneath where we were working
 	curs_set(1); //make cursor visible again
 	endwin(); //terminates NCureses mode and the stdscr object
 	cerr << "Sucessfully exited\n";
 }
 
+
+
+//Rendering///////////////////////////////////////////////////////////////////////////////
+
+//Draw a frame every 1 / FRAME_RATE seconds until close(). A frame that runs late does
+//not make the next ones hurry to catch up
+void CursesHandler::render_loop() {
+	chrono::microseconds 	  period(1000000 / FRAME_RATE);
+	chrono::steady_clock::time_point next = chrono::steady_clock::now();
+	unique_lock<mutex> 		  stop(stopLock);
+	
+	while (!stopping) {
+		next += period;
+		if (next < chrono::steady_clock::now()) {next = chrono::steady_clock::now();}
+		
+		if (stopWake.wait_until(stop, next, [this] {return stopping;})) {break;}
+		
+		stop.unlock();
+		{
+			lock_guard<mutex> curses(cursesLock);
+			draw();
+		}
+		stop.lock();
+	}
+}
+
+//Draw the rows printed since the last call that differ from what the terminal shows
+//(in input mode, every one: the user may have typed over it), with a single refresh()
+void CursesHandler::draw() {
+	vector<int> changed;
+	int row, col;
+	
+	{
+		lock_guard<mutex> guard(screenLock);
+		for (unsigned r = 0; r < rows.size(); r++) {
+			if (!dirty[r]) {continue;}
+			
+			dirty[r] = false;
+			if (inputMode || rows[r] != shown[r]) {
+				shown[r] = rows[r];
+				changed.push_back(r);
+			}
+		}
+		row = cursorRow;
+		col = cursorCol;
+	}
+	
+	for (unsigned i = 0; i < changed.size(); i++) {
+		move(changed[i], 0);
+		clrtoeol();
+		mvaddnstr(changed[i], 0, shown[changed[i]].c_str(), consoleWidth);
+	}
+	if (inputMode) {move(row, col);} //where the input echoes
+	if (inputMode || !changed.empty()) {refresh();}
+}
+
+//Write text over row from col on, as mvprintw would
+void CursesHandler::put(int row, int col, const string &text) {
+	if (row < 0 || row >= (int) rows.size()) {return;}
+	
+	string &r = rows[row];
+	if ((int) r.size() < col) {r.resize(col, ' ');}
+	r.replace(col, text.size(), text);
+	dirty[row] = true;
+	
+	cursorRow = row;
+	cursorCol = col + text.size();
+}
+
+//Blank row from col on, as clrtoeol would
+void CursesHandler::clear(int row, int col) {
+	if (row < 0 || row >= (int) rows.size()) {return;}
+	
+	if ((int) rows[row].size() > col) {rows[row].resize(col);}
+	dirty[row] = true;
+	
+	cursorRow = row;
+	cursorCol = col;
+}
+
+string CursesHandler::format(const char *str, ...) {
+	char 	buffer[512];
+	va_list args;
+	
+	va_start(args, str);
+	vsnprintf(buffer, sizeof(buffer), str, args);
+	va_end(args);
+	return buffer;
+}
+
+CursesHandler::Edit::Edit(CursesHandler *win) {
+	this->win = win;
+	if (!win->batching) {win->screenLock.lock();}
+}
+
+CursesHandler::Edit::~Edit() {
+	if (win->batching) {return;}
+	
+	win->screenLock.unlock();
+	if (win->inputMode) {win->draw();}
+}
+
+void CursesHandler::begin_batch() {
+	if (headless) {return;}
+	screenLock.lock();
+	batching = true;
+}
+
+void CursesHandler::end_batch() {
+	if (headless) {return;}
+	batching = false;
+	screenLock.unlock();
+	if (inputMode) {draw();}
+}
+
+
+
 //SharkBatch calls wireframe to create the UI skeleton of the entire program. Here, each
 //"bar" is given a nice border and title in the appropriate place. For row numbers, the
 //constant bar row specifiers are not used to make it easier to make adjustments to the UI
 //in the future.
 void CursesHandler::wireframe(int numQueues) {
-	mvprintw(0, COL_LOCATION, "----------------------------------------------------------"
-							  "--------------------------");
-	mvprintw(1, COL_LOCATION, "MENU");
-	mvprintw(2, COL_LOCATION, "----");
+	if (headless) {return;}
+	Edit edit(this);
+	put(0, COL_LOCATION, "----------------------------------------------------------"
+						 "--------------------------");
+	put(1, COL_LOCATION, "MENU");
+	put(2, COL_LOCATION, "----");
 	
-	mvprintw(4, COL_LOCATION, "----------------------------------------------------------"
-							  "--------------------------");
-	mvprintw(5, COL_LOCATION, "CONSOLE");
-	mvprintw(6, COL_LOCATION, "-------");
+	put(4, COL_LOCATION, "----------------------------------------------------------"
+						 "--------------------------");
+	put(5, COL_LOCATION, "CONSOLE");
+	put(6, COL_LOCATION, "-------");
 	
-	mvprintw(14, COL_LOCATION, "---------------------------------------------------------"
-							   "---------------------------");
-	mvprintw(15, COL_LOCATION, "STATUS OVERVIEW");
-	mvprintw(16, COL_LOCATION, "---------------");
+	put(14, COL_LOCATION, "---------------------------------------------------------"
+						  "---------------------------");
+	put(15, COL_LOCATION, "STATUS OVERVIEW");
+	put(16, COL_LOCATION, "---------------");
 	
-	mvprintw(19, COL_LOCATION, "Priority:");
+	put(19, COL_LOCATION, "Priority:");
 	
 	//print the priority numbers based on the passed int numQueues
 	for (int i = 0; i < numQueues; i++) {
-		mvprintw(19, 15 + i * 4, "%d |", i);
+		put(19, 15 + i * 4, format("%d |", i));
 	}
 	
-	mvprintw(19, 15 + numQueues * 4, "W");
+	put(19, 15 + numQueues * 4, "W");
 	
-	mvprintw(22, COL_LOCATION, "---------------------------------------------------------"
-							   "---------------------------");
-	mvprintw(23, COL_LOCATION, "CURRENT CORE THREAD");
-	mvprintw(24, COL_LOCATION, "-------------------");
+	put(22, COL_LOCATION, "---------------------------------------------------------"
+						  "---------------------------");
+	put(23, COL_LOCATION, "CURRENT CORE THREAD");
+	put(24, COL_LOCATION, "-------------------");
 	
-	mvprintw(29, COL_LOCATION, "---------------------------------------------------------"
-							   "---------------------------");
-	mvprintw(30, COL_LOCATION, "LOG");
-	mvprintw(31, COL_LOCATION, "---");
-
-	mvprintw(44, COL_LOCATION, "---------------------------------------------------------"
-							   "---------------------------");
-	mvprintw(45, COL_LOCATION, "STATISTICS");
-	mvprintw(46, COL_LOCATION, "----------");	
-
-	mvprintw(53, COL_LOCATION, "---------------------------------------------------------"
-							   "---------------------------");	
+	put(29, COL_LOCATION, "---------------------------------------------------------"
+						  "---------------------------");
+	put(30, COL_LOCATION, "LOG");
+	put(31, COL_LOCATION, "---");
+
+	put(44, COL_LOCATION, "---------------------------------------------------------"
+						  "---------------------------");
+	put(45, COL_LOCATION, "STATISTICS");
+	put(46, COL_LOCATION, "----------");	
+
+	put(53, COL_LOCATION, "---------------------------------------------------------"
+						  "---------------------------");	
 }
 
 
@@ -101,20 +255,53 @@ void CursesHandler::wireframe(int numQueues) {
 
 //Ensures input echoing is displayed in menu bar
 void CursesHandler::CursesHandler::keep_cursor_in_menu(int num) {
-	move(MENU_ROW, 44 + num * 3);
+	if (headless) {return;}
+	Edit edit(this);
+	cursorRow = MENU_ROW;
+	cursorCol = 44 + num * 3;
+}
+
+//Polls for a key without ever waiting on the render thread: if it is mid frame, the key
+//is picked up on a later call. Either way, no key means a 1 ms nap, which paces the
+//scheduling loop the way getch()'s timeout used to
+int CursesHandler::get_key() {
+	int key = ERR;
+	
+	if (!headless && cursesLock.try_lock()) {
+		key = getch();
+		cursesLock.unlock();
+	}
+	if (key == ERR) {this_thread::sleep_for(chrono::milliseconds(1));}
+	return key;
 }
 
 //sets NCurses to take "asynchronous" I/O. If off, getch returns ERR if no key has been
-//pressed, allowing it to be checked after each iteration of in an infinite loop
+//pressed, allowing it to be checked after each iteration of in an infinite loop. The
+//whole screen is drawn again (over whatever the user typed) and frames start again
 void CursesHandler::CursesHandler::blocking_off() {
-	timeout(1); //turn off input blocking (back to asynchronous)
+	if (headless) {return;}
+	timeout(0); //turn off input blocking (back to asynchronous)
 	noecho();
 	cbreak(); //returns characters one at a time
+	
+	{
+		lock_guard<mutex> guard(screenLock);
+		dirty.assign(dirty.size(), true);
+	}
+	draw();
+	inputMode = false;
+	cursesLock.unlock();
 }
 
 //If blocking is on, an input function will pause and wait until the user does something.
-//I also want input to be echoed and the user presses enter to submit
+//I also want input to be echoed and the user presses enter to submit. Frames stop until
+//blocking_off(); every print is drawn as soon as it is made instead
 void CursesHandler::CursesHandler::blocking_on() {
+	if (headless) {return;}
+	cursesLock.lock();
+	inputMode = true;
+	draw();
+	
 	nodelay(stdscr, false); //turn on input blocking
 	echo();
 	nocbreak(); //waits for enter before a string of characters or integers is returned
@@ -139,8 +326,9 @@ bool CursesHandler::get_y_n() {
 
 //print the main menu to the menu bar
 void CursesHandler::main_menu() {
-	menu_bar("p = toggle pause. a = add job. f = add jobs from file. l = lookup. "
-	"k = kill. e = end");
+	if (headless) {return;}
+	menu_bar("p = pause. a = add. f = file. l = lookup. k = kill. s = save. "
+	"h = hist. t = trace. e = end");
 }
 
 
@@ -149,10 +337,10 @@ void CursesHandler::main_menu() {
 
 //Always takes a string.
 void CursesHandler::CursesHandler::menu_bar(string str) {
-	move(MENU_ROW, 0);
-	clrtoeol(); //these lines clear the bar from its current state
-	mvprintw(MENU_ROW, COL_LOCATION, str.c_str()); //convert the std::string to a C string
-	refresh(); //Sync the buffer
+	if (headless) {return;}
+	Edit edit(this);
+	clear(MENU_ROW, 0); //clears the bar from its current state
+	put(MENU_ROW, COL_LOCATION, format(str.c_str()));
 }
 
 
@@ -161,59 +349,66 @@ void CursesHandler::CursesHandler::menu_bar(string str) {
 
 //When printing to the console, you can optionally specify a line number to begin, and an
 //integer at the end if you are printing a printf() style %d (if you pass a str with a
-//printf() style break, mvprintw can interpret that str with the break)
+//printf() style break, it is formatted with that integer)
 
 void CursesHandler::CursesHandler::console_bar(int line, string str) {
-	move(CONSOLE_ROW + line, 0);
-	clrtoeol();
-	mvprintw(CONSOLE_ROW + line, COL_LOCATION, str.c_str());
-	refresh();
+	if (headless) {return;}
+	Edit edit(this);
+	clear(CONSOLE_ROW + line, 0);
+	put(CONSOLE_ROW + line, COL_LOCATION, format(str.c_str()));
 }
 
 void CursesHandler::console_bar(int line, string str, int num) {
-	move(CONSOLE_ROW + line, 0);
-	clrtoeol();
-	mvprintw(CONSOLE_ROW + line, COL_LOCATION, str.c_str(), num);
-	refresh();
+	if (headless) {return;}
+	Edit edit(this);
+	clear(CONSOLE_ROW + line, 0);
+	put(CONSOLE_ROW + line, COL_LOCATION, format(str.c_str(), num));
+}
+
+//Same for a printf() style %s. Anything the user typed goes here rather than in str, so
+//it is never taken as a format itself
+void CursesHandler::console_bar(int line, string str, const char *text) {
+	if (headless) {return;}
+	Edit edit(this);
+	clear(CONSOLE_ROW + line, 0);
+	put(CONSOLE_ROW + line, COL_LOCATION, format(str.c_str(), text));
 }
 
-//Passed a vector of jobs, the console will print inline the list of PIDs up to 10 PIDs
-void CursesHandler::console_bar(int line, const Job::JobList *list) {
-	move(CONSOLE_ROW + line, 0);
-	clrtoeol();
+//Passed the PIDs of a list of jobs, the console will print them inline up to 10 PIDs
+void CursesHandler::console_bar(int line, const vector<int> &pids) {
+	if (headless) {return;}
+	Edit edit(this);
+	clear(CONSOLE_ROW + line, 0);
 	
 	//if list is empty, just print "N/A"
-	if (list->empty()) {
-		mvprintw(CONSOLE_ROW + line, COL_LOCATION, "N/A");
-		refresh();
+	if (pids.empty()) {
+		put(CONSOLE_ROW + line, COL_LOCATION, "N/A");
 		return;
 	}
 	
 	//iterate and print until second to last element with commas
-	//NOTE: WHEN PRINTING INTEGERS, THE ROW IS THE LEFTMOST DIGIT, REGARDLESS OF # DIGITS
-	for (unsigned i = 0; i < list->size(); i++) {
-		printw("%d", list->at(i)->get_pid());
+	string list;
+	for (unsigned i = 0; i < pids.size(); i++) {
+		list += format("%d", pids[i]);
 		
 		//stop printing after 10 elements
 		if (i == 10) {
-			printw("......(%d more jobs)", list->size() - 10);
+			list += format("......(%d more jobs)", (int) pids.size() - 10);
 			break;
-		} else if (i != list->size() - 1) {
-			printw(", ");
+		} else if (i != pids.size() - 1) {
+			list += ", ";
 		}
 	}
-
-	refresh();
+	put(CONSOLE_ROW + line, COL_LOCATION, list);
 }
 
 //Compatibility with a C style string -- always prints the string str first and then the
 //char name[] immediately afterwards
 void CursesHandler::console_bar(string str, char name[]) {
-	move(CONSOLE_ROW, 0);
-	clrtoeol();
-	
-	mvprintw(CONSOLE_ROW, COL_LOCATION, str.c_str());
-	addstr(name); //prints a C style string to the current location of the cursor
+	if (headless) {return;}
+	Edit edit(this);
+	clear(CONSOLE_ROW, 0);
+	put(CONSOLE_ROW, COL_LOCATION, format(str.c_str()) + name);
 }
 
 void CursesHandler::console_bar(string str) {
@@ -227,11 +422,11 @@ void CursesHandler::console_bar(string str, int num) {
 //Wipe all console lines away -- useful if some lower level lines linger and were not
 //removed when an inline print function is called
 void CursesHandler::clear_console() {
+	if (headless) {return;}
+	Edit edit(this);
 	for (int i = CONSOLE_ROW; i < CONSOLE_ROW_MAX; i++) {
-		move(i, 0);
-		clrtoeol();
+		clear(i, 0);
 	}
-	refresh();
 }
 
 
@@ -239,26 +434,29 @@ void CursesHandler::clear_console() {
 //Status bar//////////////////////////////////////////////////////////////////////////////
 
 void CursesHandler::status_bar( int row, string str) {
-	mvprintw(STATUS_ROW, row, str.c_str());
-	refresh();
+	if (headless) {return;}
+	Edit edit(this);
+	put(STATUS_ROW, row, format(str.c_str()));
 }
 
 void CursesHandler::status_bar(int row, string str, int num) {
-	mvprintw(STATUS_ROW, row, str.c_str(), num);
-	refresh();
+	if (headless) {return;}
+	Edit edit(this);
+	put(STATUS_ROW, row, format(str.c_str(), num));
 }
 
 void CursesHandler::status_bar(int line, int row, string str, int num) {
-	mvprintw(STATUS_ROW + line, row, str.c_str(), num);
-	refresh();
+	if (headless) {return;}
+	Edit edit(this);
+	put(STATUS_ROW + line, row, format(str.c_str(), num));
 }
 
 void CursesHandler::clear_status_bar() {
+	if (headless) {return;}
+	Edit edit(this);
 	for (int i = STATUS_ROW; i < STATUS_ROW_MAX; i++) {
-		move(i, 0);
-		clrtoeol();
+		clear(i, 0);
 	}
-	refresh();
 }
 
 
@@ -271,28 +469,29 @@ void CursesHandler::clear_status_bar() {
 //paused or running
 
 void CursesHandler::paused_bar(bool paused) {
-	move(PAUSED_ROW, 0);
-	clrtoeol();
+	if (headless) {return;}
+	Edit edit(this);
+	clear(PAUSED_ROW, 0);
 	if (paused) {
-		mvprintw(PAUSED_ROW, COL_LOCATION, "~~Paused~~");
+		put(PAUSED_ROW, COL_LOCATION, "~~Paused~~");
 	} else {
-		mvprintw(PAUSED_ROW, COL_LOCATION, "~~Running~~");
+		put(PAUSED_ROW, COL_LOCATION, "~~Running~~");
 	}
-	refresh();
 }
 
-void CursesHandler::mode_bar(bool varyQuanta, bool chainWeighting) {
-	move(MODE_ROW, 0);
-	clrtoeol();
+void CursesHandler::mode_bar(bool varyQuanta, bool chainWeighting, bool criticalPath) {
+	if (headless) {return;}
+	Edit edit(this);
+	clear(MODE_ROW, 0);
 	
 	if (varyQuanta) {
-		mvprintw(MODE_ROW, COL_LOCATION, "~~Quanta Mode~~");
+		put(MODE_ROW, COL_LOCATION, "~~Quanta Mode~~");
 	}
-	if (chainWeighting) {
-		mvprintw(MODE_ROW, COL_LOCATION + 17, "~~Weighting Mode~~");
+	if (criticalPath) {
+		put(MODE_ROW, COL_LOCATION + 17, "~~Critical Path Mode~~");
+	} else if (chainWeighting) {
+		put(MODE_ROW, COL_LOCATION + 17, "~~Weighting Mode~~");
 	}
-	
-	refresh();
 }
 
 
@@ -301,21 +500,28 @@ void CursesHandler::mode_bar(bool varyQuanta, bool chainWeighting) {
 
 //Print lines to the core bar, must specify a line when printing
 void CursesHandler::core_bar(int line, string str, int num) {
-	move(CORE_ROW + line, 0);
-	clrtoeol();
-	mvprintw(CORE_ROW + line, COL_LOCATION, str.c_str(), num);
-	refresh();
+	if (headless) {return;}
+	Edit edit(this);
+	clear(CORE_ROW + line, 0);
+	put(CORE_ROW + line, COL_LOCATION, format(str.c_str(), num));
+}
+
+void CursesHandler::core_bar(int line, string str, int num, int num2) {
+	if (headless) {return;}
+	Edit edit(this);
+	clear(CORE_ROW + line, 0);
+	put(CORE_ROW + line, COL_LOCATION, format(str.c_str(), num, num2));
 }
 
 //When the core bar clears, it always says "N/A"
 void CursesHandler::clear_core_bar() {
+	if (headless) {return;}
+	Edit edit(this);
 	for (int i = CORE_ROW; i < CORE_ROW_MAX; i++) {
-		move(i, 0);
-		clrtoeol();
+		clear(i, 0);
 	}
 	
-	mvprintw(CORE_ROW, 0, "N/A");
-	refresh();
+	put(CORE_ROW, 0, "N/A");
 }
 
 
@@ -327,22 +533,20 @@ void CursesHandler::clear_core_bar() {
 //line. In the future I hope use an array to cycle through where the most recent line
 //is always at the top (e.g. a Facebook news feed)
 void CursesHandler::feed_bar(string str, int num) {
+	if (headless) {return;}
+	Edit edit(this);
 	if (currentFeedRow == FEED_ROW_MAX) {
 		currentFeedRow = FEED_ROW;
-		move(FEED_ROW_MAX, 0);
-		clrtoeol();
+		clear(FEED_ROW_MAX, 0);
 	}
 	
-	move(currentFeedRow, 0);
-	clrtoeol();
-
-	mvprintw(currentFeedRow, COL_LOCATION, str.c_str(), num);
+	clear(currentFeedRow, 0);
+	put(currentFeedRow, COL_LOCATION, format(str.c_str(), num));
 	
 	currentFeedRow++;
 	
-	mvprintw(currentFeedRow, COL_LOCATION, "^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^"
-										   "^^^^^^^^^^");
-	refresh();
+	put(currentFeedRow, COL_LOCATION, "^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^"
+									  "^^^^^^^^^^");
 }
 
 
@@ -350,11 +554,8 @@ void CursesHandler::feed_bar(string str, int num) {
 //Statitistcs bar/////////////////////////////////////////////////////////////////////////
 
 void CursesHandler::CursesHandler::stats_bar(int line, string str, double num) {
-	move(STATS_ROW + line, 0);
-	clrtoeol();
-	
-	mvprintw(STATS_ROW + line, COL_LOCATION, str.c_str(), num);
-	refresh();
+	if (headless) {return;}
+	Edit edit(this);
+	clear(STATS_ROW + line, 0);
+	put(STATS_ROW + line, COL_LOCATION, format(str.c_str(), num));
 }
-
-
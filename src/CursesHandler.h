@@ -17,6 +17,26 @@
  *
  * Input functions allow a variety of 
  *
+ * HEADLESS:
+ * A headless CursesHandler never initializes NCurses and every output function returns
+ * immediately, so the Scheduler can run in batch mode (e.g. piped into another program)
+ * without any changes to the code that prints to the bars.
+ *
+ * RENDERING:
+ * The print functions never touch the terminal. They only write to an in-memory copy
+ * of the screen (a string per row) under a short lock, so printing after every slice
+ * costs a few string copies instead of a terminal flush per bar. A render thread wakes
+ * FRAME_RATE times a second, copies the rows that were written since the last frame,
+ * draws only the ones that now differ from what is on the screen, and calls refresh()
+ * once for the whole frame. begin_batch() and end_batch() hold the copy for a group of
+ * prints (the status bar after a slice, say), so a frame never shows half of one.
+ *
+ * NCurses is not thread safe, so only whoever holds the curses lock calls it: the render
+ * thread while it draws, and the Scheduler thread for input. get_key() only ever tries
+ * the lock, so the Scheduler thread never waits on a frame. blocking_on() takes it for
+ * as long as the user is typing into a prompt: frames stop, and every print is drawn
+ * right away instead (with the cursor left after it, where the input echoes).
+ *
  * Printing directly the NCurses API makes for some very very very ugly looking code. This
  * is an intermediary API I created in order to shield the Scheduler from some of the
  * ugliness of NCurses. CursesHandler does not create a new window, but instead converts
@@ -28,17 +48,25 @@
 #ifndef CURSESHANDLER_H_
 #define CURSESHANDLER_H_
  
+ #include <string>
+ #include <vector>
+ #include <thread>
+ #include <mutex>
+ #include <condition_variable>
  #include "Job.h"
  
  class CursesHandler {
  	public:
- 		 CursesHandler(); //Initialization of the NCurses environment
- 		~CursesHandler(); //Returns the NCurses environment to a standard terminal window
+ 		 CursesHandler(bool headless); //Initialization of the NCurses environment
+ 		~CursesHandler(); //Calls close()
+		
+		void close(); //Draws a last frame and returns the terminal (only the first call)
  		
  		void wireframe(int numQueues); //Creates a UI skeleton for the SharkBatch program
  		
  		//Input///////////////////////////////////////////////////////////////////////////
  		
+		int get_key();			//a key pressed since the last call, or ERR after a 1 ms nap
 		int get_int_input(); 	//return integer from input (blocking must be on)
 		bool get_y_n();			//return whether user pressed y (blocking must be on)
 		void blocking_off();	//asynchronous I/O: getch returns ERR if no key pressed
@@ -57,7 +85,8 @@
 		void console_bar	      (std::string str);
 		void console_bar(int line, std::string str);
 		void console_bar(int line, std::string str, int num);
-		void console_bar(int line, const Job::JobList *list); //JobList compatibility
+		void console_bar(int line, std::string str, const char *text); //a %s, e.g. a path
+		void console_bar(int line, const std::vector<int> &pids); //a list of jobs
 
 		void clear_console(); //refresh (otherwise some lines might linger sometimes)
 		
@@ -67,11 +96,12 @@
 		void status_bar(int line, int row, std::string str, int num);
 		void clear_status_bar();
 		
-		void mode_bar(bool varyQuanta, bool chainWeighting); //display flags enabled
+		void mode_bar(bool varyQuanta, bool chainWeighting, bool criticalPath); //flags on
 		void paused_bar(bool paused); //displays running or paused
 
 		//Core bar
 		void core_bar(int line, std::string str, int num);
+		void core_bar(int line, std::string str, int num, int num2);
 		void clear_core_bar();
 
 		//Feed bar
@@ -79,6 +109,10 @@
 
 		//Statistics bar
 		void stats_bar(int line, std::string str, double num);
+		
+		//Every print between these shows up in the same frame (Scheduler thread only)
+		void begin_batch();
+		void end_batch();
 
 
  	private:
@@ -105,11 +139,52 @@
 
 		//Right now there is no left margin padding but this makes it easy to change
 		static const int COL_LOCATION = 0;
+		
+		static const int FRAME_RATE = 30; //frames per second
+		
+		//Holds the screen for one print function (unless a batch already does), then
+		//draws right away if the user is typing
+		class Edit {
+			public:
+				 Edit(CursesHandler *win);
+				~Edit();
+			private:
+				CursesHandler *win;
+		};
 
 		//Used by functions///////////////////////////////////////////////////////////////
+		bool headless;		//if true, never touch the terminal
+		bool finished;		//the terminal has been given back
 		int currentFeedRow; //used by feed row when iterating new lines
 		int consoleHeight;
 		int consoleWidth;
+		
+		//The screen as printed so far, and as last drawn
+		std::mutex 				 screenLock; //guards rows, dirty and cursor*
+		std::vector<std::string> rows;
+		std::vector<char> 		 dirty;		 //rows written since the last frame
+		int 					 cursorRow;  //just after the last print
+		int 					 cursorCol;
+		std::vector<std::string> shown;		 //render thread (or holder of cursesLock)
+		bool 					 batching;	 //Scheduler thread only
+		bool 					 inputMode;	 //...
+		
+		std::mutex 				cursesLock; //whoever calls NCurses holds this
+		std::thread 			renderer;
+		std::mutex 				stopLock;
+		std::condition_variable stopWake;
+		bool 					stopping;
+		
+		void put  (int row, int col, const std::string &text); //like mvprintw
+		void clear(int row, int col); 							//like clrtoeol
+		void draw(); //hold cursesLock
+		void render_loop();
+		
+		static std::string format(const char *str, ...); //like printw
+		
+		//Not copyable
+		CursesHandler(const CursesHandler &);
+		CursesHandler &operator=(const CursesHandler &);
  };
 
 #endif //CURSESHANDLER_H_
@@ -0,0 +1,150 @@
+/*
+ * Histogram.cpp
+ * see Histogram.h for details
+ */
+
+#include <math.h>
+#include "Histogram.h"
+
+using namespace std;
+
+Histogram::Histogram() {
+	count = 0;
+	min   = 0;
+	max   = 0;
+	sum   = 0;
+}
+
+//Below SUB_BUCKETS a value is its own bucket. Above, shift it right until SUB_BITS bits
+//are left: the top bit says which power of two (shift) and the other SUB_BITS - 1 which
+//of its SUB_BUCKETS / 2 buckets, so each power of two takes the next SUB_BUCKETS / 2
+int Histogram::bucket_of(long long value) {
+	if (value < SUB_BUCKETS) {return value;}
+
+	int shift = 63 - __builtin_clzll(value) - SUB_BITS + 1;
+	return shift * (SUB_BUCKETS / 2) + (int) (value >> shift);
+}
+
+long long Histogram::lowest_in(int bucket) {
+	if (bucket < SUB_BUCKETS) {return bucket;}
+
+	int shift = bucket / (SUB_BUCKETS / 2) - 1;
+	return (long long) (bucket - shift * (SUB_BUCKETS / 2)) << shift;
+}
+
+long long Histogram::highest_in(int bucket) {
+	return lowest_in(bucket + 1) - 1;
+}
+
+void Histogram::record(long long value) {
+	if (value < 0) {value = 0;}
+
+	unsigned b = bucket_of(value);
+	if (b >= buckets.size()) {buckets.resize(b + 1, 0);}
+	buckets[b]++;
+
+	if (count == 0 || value < min) {min = value;}
+	if (count == 0 || value > max) {max = value;}
+	count++;
+	sum += value;
+}
+
+long long Histogram::get_count() {
+	return count;
+}
+
+long long Histogram::get_min() {
+	return min;
+}
+
+long long Histogram::get_max() {
+	return max;
+}
+
+double Histogram::get_mean() {
+	return count == 0 ? 0 : sum / count;
+}
+
+//The highest value of the bucket the ceil(p% of count)th value is in, kept within the
+//values actually recorded
+long long Histogram::percentile(double p) {
+	if (count == 0) {return 0;}
+
+	long long rank = (long long) ceil(p / 100 * count);
+	long long seen = 0;
+
+	if (rank < 1) {rank = 1;}
+	for (unsigned b = 0; b < buckets.size(); b++) {
+		seen += buckets[b];
+		if (seen >= rank) {
+			long long value = highest_in(b);
+			return value > max ? max : value < min ? min : value;
+		}
+	}
+	return max;
+}
+
+void Histogram::write_json(ostream &out, double unit) {
+	const double points[] = {50, 90, 99, 99.9};
+	const char  *names[]  = {"p50", "p90", "p99", "p99.9"};
+
+	out << "{\"count\": " << count << ", \"min\": " << min / unit
+		<< ", \"mean\": " << get_mean() / unit;
+	for (int i = 0; i < 4; i++) {
+		out << ", \"" << names[i] << "\": " << percentile(points[i]) / unit;
+	}
+	out << ", \"max\": " << max / unit << ", \"buckets\": [";
+
+	//[lowest value, count] per bucket
+	bool first = true;
+	for (unsigned b = 0; b < buckets.size(); b++) {
+		if (buckets[b] == 0) {continue;}
+
+		out << (first ? "[" : ", [") << lowest_in(b) / unit << ", " << buckets[b] << "]";
+		first = false;
+	}
+	out << "]}";
+}
+
+const vector<uint64_t> &Histogram::get_buckets() {
+	return buckets;
+}
+
+double Histogram::get_sum() {
+	return sum;
+}
+
+void Histogram::restore(const vector<uint64_t> &buckets, long long min, long long max,
+						double sum) {
+	this->buckets = buckets;
+	this->min 	  = min;
+	this->max 	  = max;
+	this->sum 	  = sum;
+
+	count = 0;
+	for (unsigned b = 0; b < buckets.size(); b++) {count += buckets[b];}
+}
+
+//CompletionHistograms////////////////////////////////////////////////////////////////////
+
+//Slowdown is rounded to the nearest thousandth; a burst is at least 1
+void CompletionHistograms::record(int latency, int response, int turnaround, int burst) {
+	metric[LATENCY]	  .record(latency);
+	metric[RESPONSE]  .record(response);
+	metric[TURNAROUND].record(turnaround);
+	metric[SLOWDOWN]  .record(((long long) response * SLOWDOWN_UNIT + burst / 2) / burst);
+}
+
+void CompletionHistograms::write_json(ostream &out) {
+	out << "{";
+	for (int m = 0; m < NUM_METRICS; m++) {
+		out << (m == 0 ? "\"" : ", \"") << name_of(m) << "\": ";
+		metric[m].write_json(out, m == SLOWDOWN ? SLOWDOWN_UNIT : 1);
+	}
+	out << "}";
+}
+
+const char *CompletionHistograms::name_of(int metric) {
+	const char *names[] = {"latency", "response", "turnaround", "slowdown"};
+	return names[metric];
+}
@@ -0,0 +1,77 @@
+/*
+ * Histogram
+ *
+ * The distribution of a non-negative integer quantity (a latency in jiffies, say) in
+ * log-bucketed counts, the way HDR histograms keep them: every value below SUB_BUCKETS
+ * has a bucket of its own, and above that every power of two [2^k, 2^(k+1)) is split
+ * into SUB_BUCKETS / 2 equal buckets. So any value lands in a bucket no wider than
+ * 1 / 64 of it, and a percentile read back is within that of the exact one, however
+ * far apart the values are. record() is a count of leading zeros and an increment;
+ * the bucket array only grows up to the largest bucket recorded so far (about a
+ * thousand buckets for values up to a million).
+ *
+ * CompletionHistograms groups the four distributions the Scheduler keeps per group of
+ * completed jobs.
+ */
+
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+#include <vector>
+#include <ostream>
+#include <stdint.h>
+
+class Histogram {
+	public:
+		static const int SUB_BITS 	 = 7;
+		static const int SUB_BUCKETS = 1 << SUB_BITS;
+
+		Histogram();
+
+		void record(long long value); //O(1); a negative value counts as 0
+
+		long long get_count();
+		long long get_min();   //0 if empty
+		long long get_max();   //...
+		double 	  get_mean();  //exact, not from the buckets
+		long long percentile(double p); //0 <= p <= 100; the value p% are at or below
+
+		//Write the count, min, mean, max, p50, p90, p99, p99.9 and every bucket that is
+		//not empty as one JSON object, every value divided by unit
+		void write_json(std::ostream &out, double unit);
+
+		//The buckets as they are, for checkpoints. restore() replaces everything
+		const std::vector<uint64_t> &get_buckets();
+		double get_sum();
+		void   restore(const std::vector<uint64_t> &buckets, long long min, long long max,
+					   double sum);
+
+		static int 		 bucket_of  (long long value);
+		static long long lowest_in  (int bucket);
+		static long long highest_in (int bucket);
+
+	private:
+		std::vector<uint64_t> buckets;
+		long long count;
+		long long min;
+		long long max;
+		double 	  sum;
+};
+
+struct CompletionHistograms {
+	enum Metric {LATENCY, RESPONSE, TURNAROUND, SLOWDOWN, NUM_METRICS};
+
+	//Slowdown (response time per jiffy of burst) is a ratio, kept in thousandths
+	static const int SLOWDOWN_UNIT = 1000;
+
+	Histogram metric[NUM_METRICS];
+
+	void record(int latency, int response, int turnaround, int burst);
+
+	//{"latency": {...}, "response": {...}, ...} (see Histogram::write_json())
+	void write_json(std::ostream &out);
+
+	static const char *name_of(int metric);
+};
+
+#endif /* HISTOGRAM_H_ */
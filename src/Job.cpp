@@ -7,6 +7,7 @@
 #include <exception>
 #include <iostream>
 #include "Job.h"
+#include "JobQueue.h"
 
 using namespace std;
 
@@ -15,7 +16,12 @@ Job::Job(int pid) {
 	this->pid = pid;
 	this->status = LATENT;
 	
-	longestSuccesschain = 0;
+	id = 0; //set by the JobArena
+	
+	queueEpoch = 0;
+	queue     = NULL;
+	queueNext = NULL;
+	queuePrev = NULL;
 }
 
 //Operational methods/////////////////////////////////////////////////////////////////////
@@ -25,7 +31,6 @@ void Job::prepare(int execTime, int resources) {
 	if (this->status != LATENT) {throw runtime_error("Only initialize latent jobs");};
 	
 	this->execTime = execTime;
-	this->originalExecTime = execTime;
 	this->resources = resources;
 	this->status = WAITING;
 }
@@ -42,15 +47,40 @@ int Job::decrease_time(int time) {
 	}
 }
 
-//Remove a job by PID from the dependency vector
-void Job::remove_dependency(int pid) {
-	for (unsigned i = 0; i < dependencies.size(); i++) {
-		if (dependencies[i]->get_pid() == pid) {
-			//O(1) popping solution from Stack Overflow
-			swap(dependencies[i], dependencies.back());
-			dependencies.pop_back();
+//Remove a job from the dependency list
+void JobGraph::remove_dependency(uint32_t id) {
+	for (unsigned i = 0; i < dependencies.count; i++) {
+		if (dependencies.items[i] == id) {
+			//O(1) popping: move the last one into its place
+			dependencies.items[i] = dependencies.items[--dependencies.count];
+		}
+	}
+}
+
+//Same for the successor list, except the order of successors matters (see Job.h)
+void JobGraph::remove_successor(uint32_t id) {
+	unsigned kept = 0;
+	
+	for (unsigned i = 0; i < successors.count; i++) {
+		if (successors.items[i] != id) {
+			successors.items[kept++] = successors.items[i];
+		}
+	}
+	successors.count = kept;
+}
+
+//Same, for many at once; an id past the end of marks is not marked
+void JobGraph::remove_marked_successors(const vector<uint8_t> &marks, uint8_t mark) {
+	unsigned kept = 0;
+	
+	for (unsigned i = 0; i < successors.count; i++) {
+		uint32_t id = successors.items[i];
+		
+		if (id >= marks.size() || marks[id] != mark) {
+			successors.items[kept++] = id;
 		}
 	}
+	successors.count = kept;
 }
 
 //Setters and getters/////////////////////////////////////////////////////////////////////
@@ -59,6 +89,10 @@ int Job::get_pid() {
 	return pid;
 }
 
+uint32_t Job::get_id() {
+	return id;
+}
+
 int Job::get_exec_time() {
 	return execTime;
 }
@@ -75,91 +109,7 @@ Job::Status Job::get_status() {
 	return status;
 }
 
-void Job::add_successor(Job *j) {
-	successors.push_back(j); //always appends to the back of the vector
-}
-
-JobList *Job::get_successors() {
-	return &successors;
-}
-
-JobList *Job::get_dependencies() {
-	return &dependencies;
-}
-
-bool Job::no_successors() {
-	return successors.empty();
-}
-
-void Job::add_dependency(Job* j) {
-	dependencies.push_back(j);
+JobQueue *Job::get_queue() {
+	return JobQueue::of(this);
 }
 
-bool Job::no_dependencies() {
-	return dependencies.empty();
-}
-
-int Job::get_original_exec() {
-	return originalExecTime;
-}
-
-void Job::set_clock_insert(int time) {
-	clockInsert = time;
-}
-
-void Job::set_clock_begin(int time) {
-	clockBegin = time;
-}
-
-void Job::set_clock_complete(int time) {
-	clockComplete = time;
-}
-
-void Job::set_longest_chain(int num) {
-	longestSuccesschain = num;
-}
-
-int Job::get_longest_chain() {
-	return longestSuccesschain;
-}
-
-//The follow 3 functions are based off basic scheduler criteria; for a brief overview, see
-//http://www.cs.tufts.edu/comp/111/notes/Scheduling.pdf
-//For more detailed information, see the ReadMe
-
-int Job::get_turnaround() {
-	return clockComplete - clockBegin;
-}
-
-int Job::get_latency() {
-	return clockBegin - clockInsert;
-}
-
-int Job::get_response() {
-	return clockComplete - clockInsert;
-}
-
-
-//Methods for testing/////////////////////////////////////////////////////////////////////
-
-void Job::print_successors() {
-	if (successors.empty()) {
-		cout << "N/A" << endl;
-	}
-	
-	for (unsigned i = 0; i < successors.size(); i++) {
-		cout << successors[i]->get_pid() << endl;
-	}
-}
-
-void Job::print_dependencies() {
-	if (dependencies.empty()) {
-		cout << "N/A" << endl;
-	}
-	
-	for (unsigned i = 0; i < dependencies.size(); i++) {
-		cout << dependencies[i]->get_pid() << endl;
-	}
-}
-
-
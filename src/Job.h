@@ -22,6 +22,17 @@
  * won't let this happen. The Scheduler creates latent jobs when a new job refers to a PID
  * that does not exist yet as a dependency. This allows a user to make a job wait for an
  * indefinite time for a job that might get added in the future.
+ *
+ * The Scheduler allocates its jobs from a JobArena, which also owns the storage of their
+ * dependency and successor lists (EdgeLists); see JobArena.h.
+ *
+ * HOT AND COLD: a Job holds only what the slice loop and the admission scan read. The
+ * rest of a job lives in columns the JobArena keeps parallel to its jobs, indexed by the
+ * job's dense id: its JobStats (clock times, only read when it completes), its JobGraph
+ * (dependencies and successors, read when it is added, completes or is killed) and, in
+ * Chain Weighting Mode, its JobChain (longest chain). So a scheduling decision reads one
+ * cache line per job, not the whole record, and a longest chain update never reads a
+ * Job at all.
  */
 
 #ifndef __job_h__
@@ -29,12 +40,95 @@
 
 #include <string>
 #include <vector>
+#include <stdint.h>
 #include "JobHashTable.h"
 
 class Job; //forward declaration prevents circular reference in typedef below
 class JobHashTable;
+class JobQueue;
+class JobArena;
+
+//A list of jobs, by their dense ids (see below), that reads like a vector but cannot be
+//changed through its interface: its storage comes from the JobArena, which is the only
+//thing that grows it. 16 bytes and no allocation of its own, so an empty list costs
+//nothing. Ids rather than pointers so the JobArena can go from an edge straight to the
+//other job's columns without reading the job itself, at half the size of a pointer
+class EdgeList {
+	public:
+		EdgeList() {
+			items    = NULL;
+			count    = 0;
+			capacity = 0;
+		}
+		
+		unsigned size()  const {return count;}
+		bool     empty() const {return count == 0;}
+		
+		uint32_t operator[](unsigned i) const {return items[i];}
+		uint32_t at        (unsigned i) const {return items[i];}
+		
+	private:
+		friend struct JobGraph;
+		friend class JobArena;
+		
+		uint32_t *items; //a block from the JobArena, NULL while capacity is 0
+		uint32_t count;
+		uint32_t capacity;
+};
+
+typedef EdgeList JobList; //injecting this everywhere
+
+//A job's clock times, recorded upon insertion, process beginning, and process complete
+//only for the purpose of calculating statistics (cold; see above)
+struct JobStats {
+	int originalExecTime;
+	int clockInsert;
+	int clockBegin;
+	int clockComplete;
+	
+	//The follow 3 functions are based off basic scheduler criteria; for a brief
+	//overview, see http://www.cs.tufts.edu/comp/111/notes/Scheduling.pdf
+	//For more detailed information, see the ReadMe
+	int get_turnaround() {return clockComplete - clockBegin;}
+	int get_latency()	 {return clockBegin - clockInsert;}
+	int get_response()	 {return clockComplete - clockInsert;}
+};
+
+//A job's place in the DAG (cold; see above)
+struct JobGraph {
+	JobList dependencies; //ids of jobs that need to finished before
+					      //this one can start. The scheduler checks whether this
+					      //is empty before it pulls it from the JobHeap which
+					      //includes all the "waiting" jobs.
+					      
+	JobList successors;   //A list of the ids of jobs that are dependent upon
+						  //this job. When this job is completed, the scheduler
+						  //will find all the jobs on this list, find take this
+						  //job's PID, and remove it from the successor's dependent
+						  //list. Note that order is important, because higher up
+						  //jobs were added earlier and thus should be the first
+						  //to enter the MLFQ in the case that the completion of
+						  //this job causes more than one successor to be able
+						  //to begin processing
+	
+	//By id, so the jobs in the list are never read
+	void remove_dependency(uint32_t id);
+	void remove_successor (uint32_t id);
+	
+	//Every successor whose marks[id] is mark, in one pass (for Scheduler::cancel())
+	void remove_marked_successors(const std::vector<uint8_t> &marks, uint8_t mark);
+};
 
-typedef std::vector<Job*> JobList; //injecting this everywhere
+//A job's longest chain (see Scheduler::deep_search_update), only kept in Chain
+//Weighting Mode, together with the scratch for one update of it. The scratch is only
+//meaningful while chainMark equals the Scheduler's current chainStamp. In Critical Path
+//Mode the chain is measured in jiffies of work instead of jobs
+struct JobChain {
+	long long longestChain;
+	int 	  chainMark;
+	int 	  chainPending; //successors in this update that have not been finished yet
+	long long chainBest;	//best longest chain offered by the finished ones
+};
 
 class Job {		
 	public:
@@ -52,8 +146,8 @@ class Job {
 		 */
 		enum Status {LATENT, WAITING, RUNNING, COMPLETE};
 		
-		//A vector of jobs
-		typedef std::vector<Job*> JobList;
+		//A list of jobs
+		typedef EdgeList JobList;
 		
 		//public methods//////////////////////////////////////////////////////////////////
 		
@@ -64,67 +158,37 @@ class Job {
 
 		//get stuff////////////////////
 		int      get_pid();
+		uint32_t get_id(); //dense index of the job's JobStats and JobGraph in the JobArena
 		int      get_exec_time();
 		int      get_resources();		
-		int      get_latency();
-		int      get_response();
-		int      get_turnaround();	
-		int      get_original_exec();
-		int		 get_deep_success();
-		int 	 get_longest_chain();
 		Status   get_status();
-		JobList *get_successors();
-		JobList *get_dependencies();
+		JobQueue *get_queue(); //the JobQueue this job is in, or NULL
 
 		//set stuff//////////////////////
 		
-		void add_dependency    (Job *j);
-		void add_successor     (Job *j);
-		void remove_dependency (int pid);
-		void set_clock_insert  (int time);
-		void set_clock_begin   (int time);
-		void set_clock_complete(int time);
 		int  decrease_time	   (int time);
-		void set_longest_chain (int num);
 		void set_status		   (Status status);
-
-		//determine stuff/////////////////
-		bool no_dependencies();
-		bool no_successors();
-
-		//print stuff to cout for testing
-		void print_successors();
-		void print_dependencies();
 		
 	private:
-		//Job metadata
-		int    pid;
-		int    execTime;
-		int    resources;
-		int    longestSuccesschain;
-		Status status;
+		friend class JobQueue;  //JobQueue owns the queue links below
+		friend class AdmissionQueue; //...and AdmissionQueue the arrival number
+		friend class JobArena;  //...and JobArena the id
 		
-		//Used for statistics
-		int originalExecTime;
-	
-		int clockInsert;
-		int clockBegin;
-		int clockComplete;
+		//Job metadata
+		int      pid;
+		uint32_t id;
+		int      execTime;
+		int      resources;
+		Status   status;
 		
-		JobList dependencies; //pointers to jobs that need to finished before
-						      //this one can start. The scheduler checks whether this
-						      //is empty before it pulls it from the JobHeap which
-						      //includes all the "waiting" jobs.
-						      
-		JobList successors;   //A vector of pointers to jobs that are dependent upon
-							  //this job. When this job is completed, the scheduler
-							  //will find all the jobs on this list, find take this
-							  //job's PID, and remove it from the successor's dependent
-							  //list. Note that order is important, because higher up
-							  //jobs were added earlier and thus should be the first
-							  //to enter the MLFQ in the case that the completion of
-							  //this job causes more than one successor to be able
-							  //to begin processing
+		//Intrusive JobQueue links: the queue the job was pushed to (NULL if none), in
+		//which of its epochs (see JobQueue::splice()), and its neighbours there. Only
+		//JobQueue touches these
+		uint32_t  queueEpoch;
+		JobQueue *queue;
+		Job		 *queueNext;
+		Job		 *queuePrev;
+		long	  admitSeq; //when the job started waiting on memory (see AdmissionQueue)
 };
 
 #endif // __job_h__
\ No newline at end of file
@@ -0,0 +1,163 @@
+/*
+ * JobArena.cpp
+ * see JobArena.h for details
+ */
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include "JobArena.h"
+
+using namespace std;
+
+JobArena::JobArena(bool keepChains) {
+	this->keepChains = keepChains;
+	
+	slabUsed  = SLAB_JOBS; //the first make() starts a slab
+	chunkUsed = EDGE_CHUNK;
+	bigBytes  = 0;
+	
+	for (int c = 0; c < NUM_CLASSES; c++) {freeBlocks[c] = NULL;}
+}
+
+JobArena::~JobArena() {
+	for (unsigned i = 0; i < slabs.size(); i++) {
+		free(slabs[i]);
+		free(statSlabs[i]);
+		free(graphSlabs[i]);
+		if (keepChains) {free(chainSlabs[i]);}
+	}
+	for (unsigned i = 0; i < chunks.size(); i++) 	{delete [] chunks[i];}
+	for (unsigned i = 0; i < bigBlocks.size(); i++) {delete [] bigBlocks[i];}
+}
+
+Job *JobArena::make(int pid) {
+	uint32_t id;
+	
+	if (!freeJobs.empty()) {
+		id = freeJobs.back()->id;
+		freeJobs.pop_back();
+	} else {
+		if (slabUsed == SLAB_JOBS) {
+			slabs.push_back	   (static_cast<Job*>	  (allocate_slab(sizeof(Job))));
+			statSlabs.push_back (static_cast<JobStats*>(allocate_slab(sizeof(JobStats))));
+			graphSlabs.push_back(static_cast<JobGraph*>(allocate_slab(sizeof(JobGraph))));
+			if (keepChains) {
+				chainSlabs.push_back(static_cast<JobChain*>(
+									 allocate_slab(sizeof(JobChain))));
+			}
+			slabUsed = 0;
+		}
+		id = (slabs.size() - 1) * SLAB_JOBS + slabUsed++;
+	}
+	
+	Job *j = new (slabs[id / SLAB_JOBS] + id % SLAB_JOBS) Job(pid);
+	
+	j->id = id;
+	new (&stats(j)) JobStats();
+	new (&graph(j)) JobGraph();
+	if (keepChains) {new (&chain(j)) JobChain();}
+	return j;
+}
+
+void JobArena::release(Job *j) {
+	release_list(graph(j).dependencies);
+	release_list(graph(j).successors);
+	freeJobs.push_back(j);
+}
+
+void JobArena::reset(Job *j) {
+	JobGraph &g 		= graph(j);
+	EdgeList successors = g.successors;
+	uint32_t id 		= j->id;
+	int 	 pid 		= j->pid;
+	
+	release_list(g.dependencies);
+	new (j)  Job(pid);
+	new (&g) JobGraph();
+	j->id 		 = id;
+	g.successors = successors;
+}
+
+void JobArena::link(Job *dependency, Job *successor) {
+	push(graph(successor).dependencies, dependency->id);
+	push(graph(dependency).successors, successor->id);
+}
+
+void JobArena::release_successors(Job *j) {
+	release_list(graph(j).successors);
+	graph(j).successors = EdgeList();
+}
+
+size_t JobArena::get_bytes() {
+	size_t perJob = sizeof(Job) + sizeof(JobStats) + sizeof(JobGraph) +
+					(keepChains ? sizeof(JobChain) : 0);
+	
+	return slabs.size() * SLAB_JOBS * perJob + chunks.size() * EDGE_CHUNK * sizeof(uint32_t) +
+		   bigBytes;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+//Append id, moving the list to a block twice the size if it is full
+void JobArena::push(EdgeList &list, uint32_t id) {
+	if (list.count == list.capacity) {
+		uint32_t  capacity = list.capacity == 0 ? 2 : 2 * list.capacity;
+		uint32_t *items    = allocate_block(size_class(capacity));
+		
+		if (list.count > 0) {memcpy(items, list.items, list.count * sizeof(uint32_t));}
+		release_list(list);
+		list.items    = items;
+		list.capacity = capacity;
+	}
+	list.items[list.count++] = id;
+}
+
+//Put the list's block on the free list of its size class. The list itself is left as it
+//was; the caller forgets it
+void JobArena::release_list(EdgeList &list) {
+	if (list.capacity == 0) {return;}
+	
+	int c = size_class(list.capacity);
+	
+	memcpy(list.items, &freeBlocks[c], sizeof(uint32_t*)); //a block holds at least 2 ids
+	freeBlocks[c] = list.items;
+}
+
+uint32_t *JobArena::allocate_block(int sizeClass) {
+	size_t 	  size  = (size_t) 2 << sizeClass;
+	uint32_t *block = freeBlocks[sizeClass];
+	
+	if (block != NULL) {
+		memcpy(&freeBlocks[sizeClass], block, sizeof(uint32_t*));
+		return block;
+	}
+	
+	if (size > (size_t) EDGE_CHUNK) {
+		bigBlocks.push_back(new uint32_t[size]);
+		bigBytes += size * sizeof(uint32_t);
+		return bigBlocks.back();
+	}
+	
+	if (chunkUsed + size > (size_t) EDGE_CHUNK) { //the rest of the chunk is wasted
+		chunks.push_back(new uint32_t[EDGE_CHUNK]);
+		chunkUsed = 0;
+	}
+	block = chunks.back() + chunkUsed;
+	chunkUsed += size;
+	return block;
+}
+
+//SLAB_JOBS records of recordSize bytes, starting on a cache line (a multiple of 64 bytes
+//because SLAB_JOBS is)
+void *JobArena::allocate_slab(size_t recordSize) {
+	void *slab = aligned_alloc(64, SLAB_JOBS * recordSize);
+	
+	if (slab == NULL) {throw bad_alloc();}
+	return slab;
+}
+
+//capacity is a power of two from 2 up: 2 << class
+int JobArena::size_class(uint32_t capacity) {
+	return 30 - __builtin_clz(capacity);
+}
@@ -0,0 +1,96 @@
+/*
+ * JobArena
+ *
+ * Where the Scheduler's jobs and their dependency and successor lists live. Loading a
+ * big DAG used to mean a new Job and two growing vectors per job -- millions of small
+ * allocations scattered over the heap, each with its own header. Here:
+ *
+ * JOBS are placed in slabs of SLAB_JOBS jobs, handed out in order, so jobs made one after
+ * the other sit next to each other. A killed job's slot goes on a free list and is the
+ * next one handed out. Each job gets a dense id, its slot's index over all slabs.
+ *
+ * COLUMNS: every job slab has a slab of JobStats, one of JobGraphs and (only if the
+ * arena keeps chains) one of JobChains next to it; see Job.h for the hot/cold split.
+ * stats(j), graph(j) and chain(j) find j's by its id. Slabs start on a cache line, so a
+ * JobGraph never straddles two.
+ *
+ * EDGE LISTS (see EdgeList in Job.h) are blocks of 2, 4, 8, ... job ids carved from
+ * chunks of EDGE_CHUNK ids. A list that fills up moves to a block twice the size and
+ * its old block goes on the free list of its size class, where the next list to grow
+ * into that size picks it up. A block bigger than a chunk gets a chunk of its own.
+ *
+ * Nothing here has anything to destruct, so the destructor releases everything in bulk:
+ * one free per slab and per chunk, and no walk over the jobs.
+ */
+
+#ifndef JOBARENA_H_
+#define JOBARENA_H_
+
+#include <vector>
+#include <stddef.h>
+#include "Job.h"
+
+class JobArena {
+	public:
+		static const int SLAB_JOBS  = 4096;
+		static const int EDGE_CHUNK = 65536; //job ids
+		static const int NUM_CLASSES = 31;	 //block sizes 2 << class
+
+		 JobArena(bool keepChains); //keep a JobChain column (for Chain Weighting Mode)
+		~JobArena(); //every job and every list at once
+
+		Job *make(int pid); //a new latent job (see Job.h)
+
+		//Give j's slot and lists back. j must not be referenced by anything anymore
+		void release(Job *j);
+		
+		//Everything by dense id (see Job.h); none of these read the job
+		Job 	 *job  (uint32_t id) {return slabs	   [id / SLAB_JOBS] + id % SLAB_JOBS;}
+		JobStats &stats(uint32_t id) {return statSlabs [id / SLAB_JOBS][id % SLAB_JOBS];}
+		JobGraph &graph(uint32_t id) {return graphSlabs[id / SLAB_JOBS][id % SLAB_JOBS];}
+		JobChain &chain(uint32_t id) {return chainSlabs[id / SLAB_JOBS][id % SLAB_JOBS];}
+		
+		JobStats &stats(Job *j) {return stats(j->id);}
+		JobGraph &graph(Job *j) {return graph(j->id);}
+		JobChain &chain(Job *j) {return chain(j->id);}
+
+		//Turn j back into a latent job in place (so pointers to it stay good), keeping
+		//its PID and successors, and its chain (which is theirs). Its dependencies must
+		//not list it as a successor anymore
+		void reset(Job *j);
+
+		//successor depends on dependency: append each to the other's list
+		void link(Job *dependency, Job *successor);
+
+		//Give the storage of j's successor list back (j is done with it)
+		void release_successors(Job *j);
+		
+		//Append id to list (one of a job's in graph()) alone, where link() would add to
+		//both sides; for restoring lists in exactly the order they were in
+		void append(EdgeList &list, uint32_t id) {push(list, id);}
+
+		size_t get_bytes(); //held from the heap by slabs and chunks
+
+	private:
+		std::vector<Job*>	   slabs;
+		std::vector<JobStats*> statSlabs;  //parallel to slabs
+		std::vector<JobGraph*> graphSlabs; //...
+		std::vector<JobChain*> chainSlabs; //...if keepChains
+		bool 				   keepChains;
+		int				   	   slabUsed; //jobs handed out of slabs.back()
+		std::vector<Job*> 	   freeJobs;
+
+		std::vector<uint32_t*> chunks;
+		size_t 				   chunkUsed; //ids handed out of chunks.back()
+		uint32_t 			  *freeBlocks[NUM_CLASSES]; //linked through their first 8 bytes
+		std::vector<uint32_t*> bigBlocks; //the ones bigger than a chunk
+		size_t 				   bigBytes;
+
+		void 	  push(EdgeList &list, uint32_t id);
+		void 	  release_list(EdgeList &list);
+		uint32_t *allocate_block(int sizeClass);
+		static int   size_class(uint32_t capacity);
+		static void *allocate_slab(size_t recordSize);
+};
+
+#endif /* JOBARENA_H_ */
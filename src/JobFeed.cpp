@@ -0,0 +1,98 @@
+/*
+ * JobFeed.cpp
+ * see JobFeed.h for details
+ */
+
+#include <algorithm>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "JobFeed.h"
+
+using namespace std;
+
+JobFeed::JobFeed() {
+	fd       = -1;
+	lines    = 0;
+	jobs     = 0;
+	maxLag   = 0;
+	totalLag = 0;
+}
+
+JobFeed::~JobFeed() {
+	if (fd >= 0) {close(fd);}
+}
+
+//O_NONBLOCK: opening a FIFO for reading does not wait for a writer, and reads return
+//at once whether or not anything is there
+bool JobFeed::open(const char *path) {
+	if (fd >= 0) {close(fd);}
+
+	fd = ::open(path, O_RDONLY | O_NONBLOCK);
+	drainedAt = pendingSince = batchSince = Clock::now();
+	return fd >= 0;
+}
+
+int JobFeed::poll(vector<TraceReader::Record> &records,
+				  vector<TraceReader::Error> &errors) {
+	Clock::time_point before = drainedAt; //whatever is read now was written after this
+	size_t  old = pending.size();
+	ssize_t n;
+
+	pending.resize(old + BATCH_BYTES);
+	n = read(fd, &pending[old], BATCH_BYTES); //-1 (EAGAIN) or 0 if nothing is there
+	pending.resize(old + (n > 0 ? n : 0));
+
+	if (n < (ssize_t) BATCH_BYTES) {drainedAt = Clock::now();}
+	if (old == 0 && n > 0) 		   {pendingSince = before;}
+
+	//Only parse up to the last newline; the rest of a line is still being written
+	size_t len = pending.size();
+	while (len > 0 && pending[len - 1] != '\n') {len--;}
+	if (len == 0) {return 0;}
+
+	TraceReader::Record r;
+	int count = 0;
+
+	parser.open_memory(&pending[0], len);
+	while (parser.next(r)) {
+		r.line += lines;
+		records.push_back(r);
+		count++;
+	}
+
+	vector<TraceReader::Error> &parseErrors = parser.get_errors();
+	for (unsigned i = 0; i < parseErrors.size(); i++) {
+		parseErrors[i].line += lines;
+		errors.push_back(parseErrors[i]);
+	}
+
+	lines     += std::count(pending.begin(), pending.begin() + len, '\n');
+	batchSince = pendingSince;
+	pending.erase(pending.begin(), pending.begin() + len);
+
+	//What is left came after the last newline, so it was all read just now
+	if (!pending.empty()) {pendingSince = before;}
+
+	return count;
+}
+
+void JobFeed::ingested(int count) {
+	chrono::duration<double, milli> lag = Clock::now() - batchSince;
+
+	jobs     += count;
+	totalLag += lag.count() * count;
+	if (count > 0 && lag.count() > maxLag) {maxLag = lag.count();}
+}
+
+int JobFeed::get_jobs() {
+	return jobs;
+}
+
+double JobFeed::get_max_lag() {
+	return maxLag;
+}
+
+double JobFeed::get_avg_lag() {
+	return jobs == 0 ? 0 : totalLag / jobs;
+}
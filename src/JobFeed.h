@@ -0,0 +1,67 @@
+/*
+ * JobFeed
+ *
+ * A live source of jobs: a named pipe (FIFO) or an append-only file that submitters keep
+ * writing text job records to (the sample-datasets/ format, one job per line). The
+ * Scheduler calls poll() between slices; it reads whatever has arrived without ever
+ * blocking, at most BATCH_BYTES at a time so a flood of submissions cannot starve the
+ * MLFQ, and hands back every complete line as a record. A line that is still being
+ * written stays in the feed until its newline arrives.
+ *
+ * A FIFO survives its writers coming and going, and a tailed file simply has nothing new
+ * until something is appended.
+ *
+ * Ingestion lag: a job cannot be seen before it is written, so its lag (wallclock time
+ * from being written to being inserted into the Scheduler) is at most the time since
+ * the feed was last seen empty before its line started arriving. The Scheduler calls
+ * ingested() once a polled batch is in, and the feed keeps the worst and average of that
+ * upper bound.
+ */
+
+#ifndef JOBFEED_H_
+#define JOBFEED_H_
+
+#include <vector>
+#include <chrono>
+#include "TraceReader.h"
+
+class JobFeed {
+	public:
+		static const size_t BATCH_BYTES = 65536;
+
+		 JobFeed();
+		~JobFeed();
+
+		bool open(const char *path); //false if it cannot be opened
+
+		//Append the records of every complete line read now to records, and their syntax
+		//errors (line numbers count from the start of the feed) to errors. Never blocks.
+		//Return the number of records appended
+		int poll(std::vector<TraceReader::Record> &records,
+				 std::vector<TraceReader::Error> &errors);
+
+		//count jobs from the last poll() are now in the Scheduler
+		void ingested(int count);
+
+		int    get_jobs();
+		double get_max_lag(); //milliseconds (upper bounds, see above)
+		double get_avg_lag();
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		int fd;
+		int lines;					//complete lines taken from the feed so far
+		std::vector<char> pending;  //bytes read but not yet parsed (a partial line)
+		TraceReader parser;
+
+		Clock::time_point drainedAt;	//last time a read found nothing more
+		Clock::time_point pendingSince; //drainedAt when pending's first byte came in
+		Clock::time_point batchSince;	//...and when the last poll()'s first byte did
+
+		int    jobs;
+		double maxLag;
+		double totalLag; //summed over jobs
+};
+
+#endif /* JOBFEED_H_ */
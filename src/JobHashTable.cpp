@@ -7,143 +7,180 @@
 #include <exception>
 #include <stdexcept>
 #include <stddef.h>
+#include <stdint.h>
 #include <iostream>
-#include <vector>
 #include "JobHashTable.h"
 
 using namespace std;
 
-//create the buckets using DEFAULT_CAP
+//create the slots using DEFAULT_CAP
 JobHashTable::JobHashTable() {
-	capacity = DEFAULT_CAP;
-	buckets = new vector<Job*>[capacity];
-	size = 0;
-	
-	LOAD_FACTOR_THRESHOLD = .8;
+	init(DEFAULT_CAP);
 }
 
-//create the buckets with a specific beginning capacity
+//create the slots with a specific beginning capacity
 JobHashTable::JobHashTable(int capacity) {
-	this->capacity = capacity;
-	buckets = new vector<Job*>[capacity];
-	size = 0;
-	
-	LOAD_FACTOR_THRESHOLD = .8;
+	init(capacity);
 }
 
-//Destructor frees buckets
+//Destructor frees slots
 JobHashTable::~JobHashTable() {
-	delete [] buckets;
+	delete [] slots;
 }
 
 //Public methods//////////////////////////////////////////////////////////////////////////
 
 
 //Return a pointer to a job; if the job doesn't exist, returns NULL -- best O(1)
+//Robin hood invariant: once we reach a slot whose job probed less far than we have,
+//pid would have taken that slot on insert, so it cannot be further along
 Job *JobHashTable::find(int pid) {
-	int key = hash(pid);
-	
-	for (unsigned i = 0; i < buckets[key].size(); i++) {
-		if (buckets[key][i]->get_pid() == pid) {
-			return buckets[key][i];
+	int mask = capacity - 1;
+	int i    = hash(pid);
+
+	for (int dist = 0; slots[i].job != NULL && slots[i].dist >= dist; dist++) {
+		if (slots[i].pid == pid) {
+			return slots[i].job;
 		}
+		i = (i + 1) & mask;
 	}
 	return NULL;
 }
 
-//insert a job pointer -- always O(1)
+//insert a job pointer -- amortized O(1)
 void JobHashTable::insert(Job *j) {
-	//double LOAD_FACTOR_THRESHOLD = .8;
-	
-	buckets[hash(j->get_pid())].push_back(j);
+	Slot s = {j->get_pid(), 0, j};
+
+	place(s);
 	size++;
 
 	if (((double) size / capacity) >= LOAD_FACTOR_THRESHOLD) {
-		expand();
+		resize(capacity * 2);
 	}
 }
-		
-//Pop a job from the hash buckets (the job still exists in the heap) -- best O(1)
+
+//Pop a job from the slots (the job still exists in the heap) -- best O(1)
+//Backward shift: pull every following slot that is away from home back by one
 bool JobHashTable::remove(int pid) {
-	int key = hash(pid);
-	
-	for (unsigned i = 0; i < buckets[key].size(); i++) {
-		if (buckets[key][i]->get_pid() == pid) {
-			//An O(1) removal solution when order doesn't matter -- from Stack Overflow
-			swap(buckets[key][i], buckets[key].back());
-			buckets[key].pop_back();
+	int mask = capacity - 1;
+	int i    = hash(pid);
+
+	for (int dist = 0; slots[i].job != NULL && slots[i].dist >= dist; dist++) {
+		if (slots[i].pid == pid) {
+			int next = (i + 1) & mask;
+
+			while (slots[next].job != NULL && slots[next].dist > 0) {
+				slots[i] = slots[next];
+				slots[i].dist--;
+				i = next;
+				next = (next + 1) & mask;
+			}
+			slots[i].job = NULL;
+			size--;
+			
+			if (size < capacity / 8 && capacity > DEFAULT_CAP) {
+				resize(capacity / 2);
+			}
 			return true;
 		}
+		i = (i + 1) & mask;
 	}
 	return false;
 }
 
-//Used by the scheduler destructor as the easiest way to find all existing jobs and
-//free them from the heap. Iterate through every job in the hash table and delete the job
-void JobHashTable::destroy_all_jobs() {
+//Print to cerr for testing; does not sort PIDs in order
+void JobHashTable::print() {
 	for (int i = 0; i < capacity; i++) {
-		for (unsigned j = 0; j < buckets[i].size(); j++) {
-			delete buckets[i][j];
+		if (slots[i].job != NULL) {
+			cerr << "Slot #" << i << ": " << slots[i].pid << " (+" << slots[i].dist << ")"
+				 << endl;
 		}
 	}
 }
 
-//Print to cerr for testing; does not sort PIDs in order
-void JobHashTable::print() {
+void JobHashTable::collect(vector<Job*> &out) {
 	for (int i = 0; i < capacity; i++) {
-		cerr << "Bucket #" << i << ": ";
-		for (unsigned j = 0; j < buckets[i].size(); j++) {
-			cerr << buckets[i][j]->get_pid() << ",";
-		}
+		if (slots[i].job != NULL) {out.push_back(slots[i].job);}
 	}
 }
 
-//Worst O(N), best O(1), average O(N/2)
+//Always O(1)
 bool JobHashTable::is_empty() {
-	for (int i = 0; i < capacity; i++) {
-		if (!buckets[i].empty()) {
-			return false;
-		}
-	}
-	return true;
+	return size == 0;
 }
 
 //Private methods/////////////////////////////////////////////////////////////////////////
 
+//Allocate capacity (rounded up to a power of two) empty slots
+void JobHashTable::init(int capacity) {
+	this->capacity = 1;
+	while (this->capacity < capacity) {
+		this->capacity *= 2;
+	}
+
+	slots = new Slot[this->capacity];
+	for (int i = 0; i < this->capacity; i++) {
+		slots[i].job = NULL;
+	}
+	size = 0;
+
+	LOAD_FACTOR_THRESHOLD = .8;
+}
+
 /*
  * It's easy to change the hash function via the hash(pid) definition. Right now, it is
- * just pid modulo capacity because I assume the user will enter a random range of PIDs, 
- * but the class is designed to allow a more advanced compression if needed. hash(pid)
- * handles wrapping on its own, so if the function is changed, it should always end in
- * modulo capacity.
+ * the MurmurHash3 32 bit finalizer, which mixes every bit of the PID into every bit of
+ * the result, then wrapped with the mask. hash(pid) handles wrapping on its own, so if
+ * the function is changed, it should always end in a mask (or modulo capacity).
  */
 int JobHashTable::hash(int pid) {
-	return pid % capacity;
-}
+	uint32_t h = (uint32_t) pid;
 
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
 
-//Does not expand in place -- copies to a new vector. Always doubles the capacity when
-//expanding. Always O(n)
-//
-void JobHashTable::expand() {
-	vector<Job*> *newTable;
-	
-	capacity *= 2;
-	
-	newTable = new vector<Job*>[capacity];
-	
-	//rehash everything
-	for (int i = 0; i < capacity / 2; i++) {
-		for (unsigned j = 0; j < buckets[i].size(); j++) {
-			newTable[hash(buckets[i][j]->get_pid())].push_back(buckets[i][j]);
+	return (int) (h & (uint32_t) (capacity - 1));
+}
+
+//Robin hood insertion of s into the slots. s is carried forward until an empty slot;
+//whenever the resident of a slot is closer to home than s, they swap
+void JobHashTable::place(Slot s) {
+	int mask = capacity - 1;
+	int i    = hash(s.pid);
+
+	s.dist = 0;
+	while (slots[i].job != NULL) {
+		if (slots[i].dist < s.dist) {
+			Slot evicted = slots[i];
+			slots[i] = s;
+			s = evicted;
 		}
+		i = (i + 1) & mask;
+		s.dist++;
 	}
-	
-	delete [] buckets;
-	buckets = newTable;
+	slots[i] = s;
 }
 
+//Does not resize in place -- copies to a new array. Always doubles the capacity when
+//expanding and halves it when shrinking. Always O(n)
+//
+void JobHashTable::resize(int newCapacity) {
+	Slot *oldSlots    = slots;
+	int   oldCapacity = capacity;
+	int   oldSize     = size;
 
+	init(newCapacity);
 
+	//rehash everything
+	for (int i = 0; i < oldCapacity; i++) {
+		if (oldSlots[i].job != NULL) {
+			place(oldSlots[i]);
+		}
+	}
+	size = oldSize;
 
-
+	delete [] oldSlots;
+}
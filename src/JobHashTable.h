@@ -4,35 +4,41 @@
  * A hash table of pointers to jobs. Jobs are hashed by their PID.
  *
  * COLLISION HANDLING:
- * Uses the chaining method. I.e. an array of vectors of pointers to jobs.
+ * Uses open addressing with robin hood linear probing. Every slot stores the PID inline
+ * next to the job pointer, so a lookup compares PIDs within one flat array and never
+ * dereferences a Job (or a bucket vector) until it has found the right one. Each slot
+ * also remembers how far it sits from its home slot (its probe distance). On insert, a
+ * job that has probed further than the resident of a slot takes the slot and the
+ * resident moves on ("takes from the rich"), which keeps every probe sequence short and
+ * lets a lookup stop as soon as it passes a slot with a smaller distance than its own.
+ *
+ * DELETION:
+ * Backward shift deletion: the slots after the removed one are shifted back by one until
+ * an empty slot or a slot already at home is reached. There are no tombstones, so a
+ * table with a lot of churn never slows down.
  *
  * SPECIFYING SIZE WHEN INITIALIZING:
  * When initializing, the client can choose to manually set the capacity of the table.
- * (As the number of elements in the hash table approaches capacity, the probability
- * that the average case of a lookup is worse than O(1) increases).
+ * It is always rounded up to a power of two so the hash can be wrapped with a mask.
  *
  * HASHING:
- * It's easy to change the hash function via the hash(pid) definition. Right now, it is
- * just pid modulo capacity because I assume the user will enter a random range of PIDs, 
- * but the class is designed to allow a more advanced compression if needed. hash(pid)
- * handles wrapping on its own, so if the function is changed, it should always end in
- * modulo capacity.
+ * It's easy to change the hash function via the hash(pid) definition. A PID is mixed
+ * (the 32 bit finalizer from MurmurHash3) before it is wrapped, so strided PIDs like
+ * 1000, 2000, 3000 spread over the whole table instead of piling up in a few slots the
+ * way pid modulo capacity would. hash(pid) handles wrapping on its own.
  *
- * EXPANDING:
- * When the load factor hits .8, the table always doubles in capacity.
+ * EXPANDING AND SHRINKING:
+ * When the load factor hits .8, the table always doubles in capacity. When removals
+ * bring it under 1/8 it halves again (never below DEFAULT_CAP), so the table follows the
+ * number of jobs in it rather than the most it ever held.
  *
- * Scheduler needs to know the PIDs of all completed processses. Currently, when a job is 
- * completed, the job is stored by the program and is not freed from memory until
- * SharkBatch is terminated. For convenience, SharkBatch is implemented such that if
- * memory management becomes a problem in the future, the hash table could store nodes
- * that stores a PID and a pointer to a job, and the job could be freed upon
- * completion (a NULL jobptr would indicate the PID is completed).
+ * Scheduler needs to know the PIDs of all completed processses, but a completed job is
+ * removed from the table and freed: its PID is kept in a PidSet instead (see PidSet.h).
  */
- 
+
 #ifndef __JobHashTable_h__
 #define __JobHashTable_h__
 
-#include <vector>
 #include "Job.h"
 
 class Job;
@@ -42,36 +48,45 @@ class JobHashTable {
 		 JobHashTable();
 		 JobHashTable(int capacity);
 		~JobHashTable();
-		
+
 		//Lookup a job; if the job doesn't exist, returns NULL
 		Job *find(int pid);
 
 		//Push a job pointer
 		void insert(Job *j);
-		
+
 		//Pop a job from the hash table (the job still exists in the heap)
 		bool remove(int pid);
-		
-		//Iterate through all job pointers and free each job from the heap
-		void destroy_all_jobs();
-		
+
 		//print all to cout in no order
 		void print();
 		
+		//Append every job to out, in no order
+		void collect(std::vector<Job*> &out);
+
 		bool is_empty();
-		
+
 	private:
-		static const int DEFAULT_CAP = 100;
+		static const int DEFAULT_CAP = 128;
 				  double LOAD_FACTOR_THRESHOLD; //= .8 (my C++11 compiler doesnt support
 				  								//non-integral const - see constructor)
-				  								
-		int capacity; //N (number of buckets)
+
+		//A slot is empty iff job == NULL
+		struct Slot {
+			int  pid;
+			int  dist; //probe distance from the slot pid hashes to
+			Job *job;
+		};
+
+		int capacity; //N (number of slots, always a power of two)
 		int size;     //n (number of jobs)
-		
-		std::vector<Job*> *buckets; //a pointer to an array of vectors of pointers to jobs
-				
+
+		Slot *slots; //a flat array of capacity slots
+
 		int  hash(int pid);
-		void expand();
+		void place(Slot s);
+		void resize(int newCapacity);
+		void init(int capacity);
 };
 
-#endif //__JobHashTable_h__
\ No newline at end of file
+#endif //__JobHashTable_h__
@@ -3,15 +3,16 @@
  * by Dillon Bostwick
  *
  * Creates a FIFO JobQueue using an
- * implementation of a doubly linked list. 
+ * implementation of an intrusive doubly
+ * linked list (the links are Job members).
  * pop occurs at the frontPtr, and push
  * occurs at the backPtr. See illustration:
  *
- * frontPtr-> O <-> O <-> O <-backPtr
+ * frontPtr-> J <-> J <-> J <-backPtr
  *  <<<prev     	   next>>>
  * pop here	  		   push here
  */
- 
+
 #include <exception>
 #include <stdexcept>
 #include <iostream>
@@ -25,61 +26,45 @@ JobQueue::JobQueue() {
 	frontPtr  = NULL;
 	backPtr   = NULL;
 	sizeCount = 0;
+	epoch 	  = 0;
+	splicedTo = NULL;
 }
 
-//Deep traverse to delete everything; job pointer heads are not deleted
+//Nothing to free: the links belong to the jobs, and the jobs are not deleted (they may
+//already have been freed by the time the queue goes away)
 JobQueue::~JobQueue() {
-	if (frontPtr != NULL) {
-		Node* current = frontPtr;
-
-		while (current != backPtr) {
-			current = current->next;
-			delete    current->prev;
-		}
-	
-		delete backPtr;
-	}
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
 
 //Adds Job j to the backPtr of the list (or frontPtr & backPtr if list is empty).
-//Note: does not check if j is already in the JobQueue - will push duplicates!
+//Throws if j is already in a queue (this one or another)
 void JobQueue::push(Job *j) {
-	Node* newNode = new Node;
-	
-	newNode->head = j;
-	newNode->next = NULL;
-	
+	if (j->queue != NULL) {
+		throw runtime_error("Queue: job is already in a queue");
+	}
+
+	j->queue     = this;
+	j->queueEpoch = epoch;
+	j->queueNext = NULL;
+	j->queuePrev = backPtr;
+
 	if (empty()) {
-		frontPtr      = newNode;
-		backPtr       = newNode;
-		newNode->prev = NULL;
+		frontPtr = j;
 	} else {
-		backPtr->next = newNode;
-		newNode->prev = backPtr;
-		backPtr       = newNode;
+		backPtr->queueNext = j;
 	}
+	backPtr = j;
 	sizeCount++;
 }
 
 //Pop the Job from the frontPtr. Does not return the job, just like an STL JobQueue would.
-//Throws error if called while list is empty. Node is freed from heap when popped but the
-//job itself is not freed.
+//Throws error if called while list is empty. The job itself is not freed.
 void JobQueue::pop() {
 	if (frontPtr == NULL) //empty list
 		throw runtime_error("Queue: Cannot pop an empty queue");
 
-	if (frontPtr == backPtr) { //check if only one node in list
-		delete  frontPtr;
-		frontPtr = NULL;
-		//list is now completely empty
-	} else {
-		frontPtr = frontPtr->next;
-		delete  frontPtr->prev;
-		frontPtr->prev = NULL;
-	}
-	sizeCount--;
+	remove(frontPtr);
 }
 
 //Same as STL
@@ -93,40 +78,89 @@ Job *JobQueue::front() {
 		throw runtime_error("Queue: Cannot peek at the front of an empty queue");
 	}
 
-	return frontPtr->head;
+	return frontPtr;
 }
 
-//Function I added for SharkBatch:
-//Force remove a job from somewhere within the JobQueue. Worst case O(n) but
-//average case is much better than having to do a full dequeue/enqueue
-//cycle from the client's side!
-bool JobQueue::force_pop(int pid) {
-	Node *n = frontPtr;
-	
-	if (frontPtr == backPtr && frontPtr != NULL) { //single element list
-		delete frontPtr;
-		frontPtr = NULL;
-		backPtr = NULL;
-		return true;
+//Return the back, but does not pop the job
+Job *JobQueue::back() {
+	if (backPtr == NULL) {
+		throw runtime_error("Queue: Cannot peek at the back of an empty queue");
 	}
-	
-	while (n != NULL) {
-		if (n->head->get_pid() == pid) {
-			n->next->prev = n->prev;
-			n->prev->next = n->next;
-			
-			if (frontPtr == n) {frontPtr = n->next;}
-			if (backPtr == n)  {backPtr  = n->prev;}
-			
-			delete n;
-			return true;
-		}
-		n = n->next;
+
+	return backPtr;
+}
+
+Job *JobQueue::next(Job *j) {
+	if (of(j) != this) {
+		throw runtime_error("Queue: job is not in this queue");
 	}
-	return false;
+
+	return j->queueNext;
+}
+
+//Pop the Job from the backPtr -- the mirror image of pop(). Lets another core steal
+//the job that has waited the least amount of time in this queue
+void JobQueue::pop_back() {
+	if (backPtr == NULL)
+		throw runtime_error("Queue: Cannot pop an empty queue");
+
+	remove(backPtr);
+}
+
+//Function I added for SharkBatch:
+//Remove a job from somewhere within the JobQueue. Because the links are in the job, this
+//is O(1) wherever the job is -- no full dequeue/enqueue cycle from the client's side!
+void JobQueue::remove(Job *j) {
+	if (of(j) != this) {
+		throw runtime_error("Queue: job is not in this queue");
+	}
+
+	if (j->queuePrev == NULL) {frontPtr = j->queueNext;}
+	else 					  {j->queuePrev->queueNext = j->queueNext;}
+
+	if (j->queueNext == NULL) {backPtr = j->queuePrev;}
+	else 					  {j->queueNext->queuePrev = j->queuePrev;}
+
+	j->queue     = NULL;
+	j->queueNext = NULL;
+	j->queuePrev = NULL;
+	sizeCount--;
 }
 
 //Same as STL
 int JobQueue::size() {
 	return sizeCount;
 }
+
+//Link from's whole list in after backPtr and leave from empty, in a new epoch: the
+//jobs keep pointing at from, and of() sends those of its old epochs here
+void JobQueue::splice(JobQueue &from) {
+	if (&from == this || splicedTo != NULL ||
+		(from.splicedTo != NULL && from.splicedTo != this)) {
+		throw runtime_error("Queue: a queue can only be spliced into one other queue");
+	}
+
+	from.splicedTo = this;
+	if (from.empty()) {return;}
+
+	if (empty()) {
+		frontPtr = from.frontPtr;
+	} else {
+		backPtr->queueNext 		 = from.frontPtr;
+		from.frontPtr->queuePrev = backPtr;
+	}
+	backPtr    = from.backPtr;
+	sizeCount += from.sizeCount;
+
+	from.frontPtr  = NULL;
+	from.backPtr   = NULL;
+	from.sizeCount = 0;
+	from.epoch++;
+}
+
+JobQueue *JobQueue::of(Job *j) {
+	JobQueue *q = j->queue;
+
+	if (q != NULL && j->queueEpoch != q->epoch) {q = q->splicedTo;}
+	return q;
+}
@@ -3,13 +3,26 @@
  *
  * This Queue implementation was originally written for a previous homework but I made
  * modifications that allows the queue's API to exactly resemble many important functions
- * of the C++ STL queue API. The only addition to STL-like functions is a force_pop that
+ * of the C++ STL queue API. The only additions to STL-like functions are a remove that
  * allows me to improve the complexity of the scheduler when the client wants to
- * forcefully kill a premature process
+ * forcefully kill a premature process, and back/pop_back for work stealing.
  *
- * It uses a linked list of Nodes containing pointers to jobs. While this might not 
- * optimize complexity, it does not make a significant impact on the overhead of the
- * Scheduler given the queue's purpose.
+ * It is an intrusive doubly linked list: the links live inside the Job itself (see
+ * Job.h), so push, pop, and moving a job from one queue to another never allocate. The
+ * scheduler does this at least once per slice, so the queue never shows up in the
+ * profile. Every job also knows which queue it is in, so a job can be removed by handle
+ * in O(1) without searching (or even knowing) the queue.
+ *
+ * The catch is that a job can only be in one JobQueue at a time. That is always true in
+ * the Scheduler (a job is either waiting on memory or in exactly one priority of one
+ * core), and push() throws if it is ever violated.
+ *
+ * splice() moves a whole queue to the back of another in O(1), however many jobs it
+ * holds, by relinking only the two ends. The jobs moved still point at the queue they
+ * came from, so every queue counts epochs: a splice starts a new one, and every push
+ * stamps the job with the epoch of its queue. A job stamped with an old epoch of its
+ * queue was spliced away, into the one queue its queue is ever spliced into (which is
+ * never spliced itself), and that is where get_queue() and remove() look for it.
  */
 
 #ifndef JOBQUEUE_H_
@@ -21,29 +34,41 @@ class JobQueue {
 	public:
          JobQueue();
         ~JobQueue();
-        
+
         //All following functions resemble an STL queue
         void push(Job *j);
         void pop();
         bool empty();
         Job *front();
         int  size();
-        
-        //Allows removal of a job by PID from anywhere in the queue
-        bool force_pop(int pid);
+
+        //Peek at and pop the most recently pushed job (used for work stealing)
+        Job *back();
+        void pop_back();
+
+        //Remove j from anywhere in this queue -- always O(1). The queue j is in can be
+        //found with j->get_queue()
+        void remove(Job *j);
+
+        //The job behind j (toward the back), or NULL if j is the last. With front(),
+        //walks the queue without changing it
+        Job *next(Job *j);
+
+        //Move every job in from to the back of this queue, in order, in O(1). Throws
+        //if from was ever spliced into another queue, or this one ever spliced away
+        void splice(JobQueue &from);
+
+        //The queue j is in (following a splice), or NULL
+        static JobQueue *of(Job *j);
 
 	private:
 	//See the .cpp file for diagram of ADT -- next leads to the back, and prev leads to
 	//the front
-	struct Node {
-		Job  *head;
-		Node *next;
-		Node *prev;
-	};
-	
-	Node *frontPtr;
-	Node *backPtr;
-	int   sizeCount;
+	Job *frontPtr;
+	Job *backPtr;
+	int  sizeCount;
+	uint32_t  epoch;	 //spliced away this many times
+	JobQueue *splicedTo; //...into this queue (NULL if never)
 };
 
 #endif /* QUEUE_H_ */
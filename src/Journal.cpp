@@ -0,0 +1,297 @@
+/*
+ * Journal.cpp
+ * see Journal.h for details
+ */
+
+#include <chrono>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Journal.h"
+
+using namespace std;
+
+static const int HEADER_WORDS = 5; //type, sequence (2 words), clock, PID
+
+//FNV-1a over an entry's bytes
+static uint32_t checksum(const char *p, size_t n) {
+	uint32_t h = 2166136261u;
+
+	for (size_t i = 0; i < n; i++) {
+		h = (h ^ (unsigned char) p[i]) * 16777619u;
+	}
+	return h;
+}
+
+Journal::Journal() {
+	fd 		 = -1;
+	interval = 0;
+	sequence = 0;
+	durable  = 0;
+	commits  = 0;
+	stopping = false;
+	failed   = false;
+}
+
+Journal::~Journal() {
+	close();
+}
+
+bool Journal::open(const char *path, size_t validBytes, int64_t lastSequence,
+				   int interval) {
+	close();
+
+	fd = ::open(path, O_WRONLY | O_CREAT, 0644);
+	if (fd < 0) {return false;}
+
+	if (ftruncate(fd, validBytes) != 0 || lseek(fd, validBytes, SEEK_SET) < 0) {
+		::close(fd);
+		fd = -1;
+		return false;
+	}
+
+	this->interval = interval;
+	sequence = durable = lastSequence;
+	stopping = false;
+	failed   = false;
+	writer 	 = thread(&Journal::write_loop, this);
+	return true;
+}
+
+void Journal::append_insert(int clock, const TraceReader::Record &r) {
+	if (failed) {return;}
+	start(INSERT, clock, r.pid);
+	scratch.push_back(r.execTime);
+	scratch.push_back(r.resources);
+	scratch.push_back(r.deps.size());
+	scratch.insert(scratch.end(), r.deps.begin(), r.deps.end());
+	finish();
+}
+
+void Journal::append_kill(int clock, int pid) {
+	if (failed) {return;}
+	start(KILL, clock, pid);
+	finish();
+}
+
+void Journal::append_cancel(int clock, int pid) {
+	if (failed) {return;}
+	start(CANCEL, clock, pid);
+	finish();
+}
+
+void Journal::append_complete(int clock, int pid, int core, int level, int clockInsert,
+							  int clockBegin) {
+	if (failed) {return;}
+	start(COMPLETE, clock, pid);
+	scratch.push_back(core);
+	scratch.push_back(level);
+	scratch.push_back(clockInsert);
+	scratch.push_back(clockBegin);
+	finish();
+}
+
+bool Journal::close() {
+	if (fd < 0) {return !failed;}
+
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_one();
+	writer.join();
+
+	::close(fd);
+	fd = -1;
+	return !failed;
+}
+
+int64_t Journal::get_sequence() {
+	return sequence; //only ever changed by this (the Scheduler) thread
+}
+
+int64_t Journal::get_durable() {
+	lock_guard<mutex> guard(lock);
+	return durable;
+}
+
+long Journal::get_commits() {
+	lock_guard<mutex> guard(lock);
+	return commits;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+void Journal::start(Type type, int clock, int pid) {
+	int64_t next = sequence + 1;
+
+	scratch.resize(HEADER_WORDS);
+	scratch[0] = type;
+	memcpy(&scratch[1], &next, sizeof(next));
+	scratch[3] = clock;
+	scratch[4] = pid;
+}
+
+//The wakeup is only worth its system call when the writer should not wait for its
+//interval to run out
+void Journal::finish() {
+	const char *entry  = reinterpret_cast<const char *>(&scratch[0]);
+	uint32_t 	header[2] = {(uint32_t) (scratch.size() * sizeof(int32_t)), 0};
+	bool 		full;
+
+	header[1] = checksum(entry, header[0]);
+
+	{
+		lock_guard<mutex> guard(lock);
+		const char *h = reinterpret_cast<const char *>(header);
+
+		pending.insert(pending.end(), h, h + sizeof(header));
+		pending.insert(pending.end(), entry, entry + header[0]);
+		sequence++;
+		full = pending.size() >= FLUSH_BYTES;
+	}
+	if (interval == 0 || full) {wake.notify_one();}
+}
+
+//One commit per round: take everything pending, write it and sync it with the lock let
+//go, so appends carry on into the next round meanwhile
+void Journal::write_loop() {
+	unique_lock<mutex> guard(lock);
+	vector<char> 	   writing;
+
+	while (true) {
+		if (!stopping && interval == 0 && pending.empty()) {
+			wake.wait(guard);
+		} else if (!stopping && interval > 0) {
+			wake.wait_for(guard, chrono::milliseconds(interval));
+		}
+
+		//Once failed, nothing more is written (an append that raced the failure may
+		//still have left something pending)
+		if (pending.empty() || failed) {
+			pending.clear();
+			if (stopping) {break;}
+			continue;
+		}
+
+		int64_t last = sequence;
+		writing.swap(pending);
+		guard.unlock();
+
+		bool written = true;
+		for (size_t done = 0; written && done < writing.size(); ) {
+			ssize_t n = write(fd, &writing[done], writing.size() - done);
+
+			if (n < 0 && errno == EINTR) {continue;}
+			written = n > 0;
+			done   += n > 0 ? n : 0;
+		}
+		written = written && fdatasync(fd) == 0;
+		writing.clear();
+
+		guard.lock();
+		if (written) {
+			durable = last;
+			commits++;
+		} else {
+			failed = true;
+			pending.clear();
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+JournalReader::JournalReader() {
+	data 	 = NULL;
+	size 	 = 0;
+	position = 0;
+}
+
+JournalReader::~JournalReader() {
+	if (size > 0) {munmap((void *) data, size);}
+}
+
+bool JournalReader::open(const char *path) {
+	struct stat st;
+	int file = ::open(path, O_RDONLY);
+
+	if (file < 0) {return errno == ENOENT;}
+	if (fstat(file, &st) != 0) {
+		::close(file);
+		return false;
+	}
+	if (st.st_size == 0) {
+		::close(file);
+		return true;
+	}
+
+	void *m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (m == MAP_FAILED) {return false;}
+
+	madvise(m, st.st_size, MADV_SEQUENTIAL);
+	data = static_cast<const char *>(m);
+	size = st.st_size;
+	return true;
+}
+
+bool JournalReader::next(Journal::Entry &e) {
+	uint32_t header[2];
+	int32_t  word[HEADER_WORDS + 4];
+
+	if (size - position < sizeof(header)) {return false;}
+	memcpy(header, data + position, sizeof(header));
+
+	const char *entry  = data + position + sizeof(header);
+	size_t 		length = header[0];
+	size_t 		words  = length / sizeof(int32_t);
+
+	if (length % sizeof(int32_t) != 0 || words < HEADER_WORDS ||
+		length > size - position - sizeof(header) || checksum(entry, length) != header[1]) {
+		return false;
+	}
+
+	memcpy(word, entry, HEADER_WORDS * sizeof(int32_t));
+	e.type 		 	= (Journal::Type) word[0];
+	memcpy(&e.sequence, &word[1], sizeof(e.sequence));
+	e.clock 	 	= word[3];
+	e.record.pid 	= word[4];
+	e.record.line 	= 0;
+	e.record.deps.clear();
+
+	size_t extra = e.type == Journal::INSERT ? 3 : e.type == Journal::COMPLETE ? 4 : 0;
+	if (words < HEADER_WORDS + extra || e.type < Journal::INSERT ||
+		e.type > Journal::CANCEL) {
+		return false;
+	}
+	memcpy(word + HEADER_WORDS, entry + HEADER_WORDS * sizeof(int32_t),
+		   extra * sizeof(int32_t));
+
+	if (e.type == Journal::INSERT) {
+		e.record.execTime  = word[5];
+		e.record.resources = word[6];
+		if (word[7] < 0 || words != HEADER_WORDS + 3 + (size_t) word[7]) {return false;}
+
+		e.record.deps.resize(word[7]);
+		if (word[7] > 0) {
+			memcpy(&e.record.deps[0], entry + (HEADER_WORDS + 3) * sizeof(int32_t),
+				   word[7] * sizeof(int32_t));
+		}
+	} else if (e.type == Journal::COMPLETE) {
+		e.core 		  = word[5];
+		e.level 	  = word[6];
+		e.clockInsert = word[7];
+		e.clockBegin  = word[8];
+	}
+
+	position += sizeof(header) + length;
+	return true;
+}
+
+size_t JournalReader::get_valid_bytes() {
+	return position;
+}
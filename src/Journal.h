@@ -0,0 +1,137 @@
+/*
+ * Journal
+ *
+ * A write-ahead journal of everything that changes which jobs exist: every job made,
+ * killed, cancelled and completed is appended to a file, so an instance that crashes
+ * can replay it on top of its last checkpoint (see Scheduler::journal_to()) and carry on
+ * where it was rather than where the checkpoint was.
+ *
+ * GROUP COMMIT: the Scheduler thread never writes or syncs. append() copies the entry
+ * into a pending buffer (a short, uncontended lock) and returns. A writer thread of the
+ * journal's own wakes up every interval milliseconds (or as soon as anything is pending
+ * if the interval is 0, or once FLUSH_BYTES are pending), takes the whole buffer,
+ * writes it and fdatasync()s once for all of it. So an entry is durable at most about
+ * interval plus one sync after it was appended, and a burst of a thousand completions
+ * costs one sync instead of a thousand.
+ *
+ * FAILURE: a write or fdatasync() that fails is not retried, since after a failed sync
+ * the kernel may already have dropped the pages it could not write. The journal stops
+ * there for good: what was pending is dropped, every later append is a no-op, durable
+ * stays at the last commit that made it and close() returns false. So whatever the
+ * failed round tore is the end of the file, and replay loses nothing it was told was
+ * durable.
+ *
+ * ENTRIES: a 4 byte length and a 4 byte checksum (FNV-1a) of the rest, which is the
+ * entry's type, sequence number (counting up from 1 over the life of the journal, so a
+ * checkpoint can say which entries it already includes), runClock and PID, followed by
+ *   INSERT:   execTime, resources, dependency count and dependency PIDs
+ *   KILL:     nothing
+ *   CANCEL:   nothing (the jobs that depend on it are cancelled again on replay)
+ *   COMPLETE: the core and level it completed at and the JobStats clock times
+ * All fields are 32 bit but the sequence number, in the machine's byte order. A crash
+ * in the middle of a write leaves a torn entry at the end; JournalReader stops at the
+ * first entry that is cut short or fails its checksum, and open() cuts it off before
+ * appending.
+ */
+
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+#include "TraceReader.h"
+
+class Journal {
+	public:
+		enum Type {INSERT = 1, KILL = 2, COMPLETE = 3, CANCEL = 4};
+
+		struct Entry {
+			Type	type;
+			int64_t sequence;
+			int 	clock;
+			TraceReader::Record record; //just the PID, but for an INSERT
+			int 	core;				//COMPLETE only
+			int 	level;				//...
+			int 	clockInsert;		//...
+			int 	clockBegin;			//...
+		};
+
+		static const size_t FLUSH_BYTES = 1 << 20; //commit early once this much is pending
+
+		 Journal();
+		~Journal(); //close()s
+
+		//Append to path from validBytes on (dropping whatever is after, see above), going
+		//on from sequence number lastSequence, and start the writer. False if path cannot
+		//be opened
+		bool open(const char *path, size_t validBytes, int64_t lastSequence, int interval);
+
+		//Scheduler thread only. None of these wait for the disk, and once a commit has
+		//failed none of them do anything
+		void append_insert(int clock, const TraceReader::Record &r);
+		void append_kill(int clock, int pid);
+		void append_cancel(int clock, int pid);
+		void append_complete(int clock, int pid, int core, int level, int clockInsert,
+							 int clockBegin);
+
+		//Commit everything appended, stop the writer and close the file. False if any
+		//write or sync ever failed
+		bool close();
+
+		int64_t get_sequence(); //of the last entry appended
+		int64_t get_durable();  //...and of the last one committed
+		long	get_commits();
+
+	private:
+		int fd;
+		int interval; //milliseconds between commits
+
+		std::thread 			writer;
+		std::mutex 				lock;	   //guards everything below
+		std::condition_variable wake;
+		std::vector<char> 		pending;   //appended, not yet handed to the writer
+		int64_t 				sequence;
+		int64_t 				durable;
+		long 					commits;
+		bool 					stopping;
+		std::atomic<bool>		failed;	   //read without the lock by the appends
+
+		std::vector<int32_t> 	scratch;   //the entry being appended (Scheduler thread)
+
+		void start (Type type, int clock, int pid); //scratch holds the entry from here...
+		void finish(); 								//...until this appends it
+		void write_loop();
+
+		//Not copyable
+		Journal(const Journal &);
+		Journal &operator=(const Journal &);
+};
+
+//Reads a journal's entries back in order, from a map of the whole file
+class JournalReader {
+	public:
+		 JournalReader();
+		~JournalReader();
+
+		//False if path exists but cannot be read. A missing file is an empty journal
+		bool open(const char *path);
+
+		bool   next(Journal::Entry &e); //false at the end or at a torn entry
+		size_t get_valid_bytes();		//up to the end of the last good entry
+
+	private:
+		const char *data;
+		size_t 		size;
+		size_t 		position;
+
+		//Not copyable
+		JournalReader(const JournalReader &);
+		JournalReader &operator=(const JournalReader &);
+};
+
+#endif /* JOURNAL_H_ */
@@ -0,0 +1,66 @@
+/*
+ * LevelBitmap.cpp
+ * see LevelBitmap.h for details
+ */
+
+#include <stdexcept>
+#include "LevelBitmap.h"
+
+using namespace std;
+
+LevelBitmap::LevelBitmap() {
+	summary = 0;
+}
+
+LevelBitmap::LevelBitmap(int numLevels) {
+	if (numLevels < 0 || numLevels > MAX_LEVELS) {
+		throw logic_error("LevelBitmap: too many levels");
+	}
+
+	summary = 0;
+	words.resize((numLevels + 63) / 64, 0);
+}
+
+void LevelBitmap::set(int level) {
+	words[level >> 6] |= (uint64_t) 1 << (level & 63);
+	summary |= (uint64_t) 1 << (level >> 6);
+}
+
+void LevelBitmap::clear(int level) {
+	words[level >> 6] &= ~((uint64_t) 1 << (level & 63));
+
+	if (words[level >> 6] == 0) {
+		summary &= ~((uint64_t) 1 << (level >> 6));
+	}
+}
+
+bool LevelBitmap::test(int level) {
+	return (words[level >> 6] >> (level & 63)) & 1;
+}
+
+//63 - clz is the index of the highest set bit (clz of 0 is undefined, hence the check)
+int LevelBitmap::highest() {
+	if (summary == 0) {return -1;}
+
+	int w = 63 - __builtin_clzll(summary);
+	return w * 64 + 63 - __builtin_clzll(words[w]);
+}
+
+//Mask off everything below from in its own word first; if nothing is left there, the
+//next word up with anything in it comes from the summary
+int LevelBitmap::lowest(int from) {
+	int w = from >> 6;
+
+	if (w >= (int) words.size()) {return -1;}
+
+	uint64_t bits = words[w] & (~(uint64_t) 0 << (from & 63));
+	if (bits != 0) {
+		return w * 64 + __builtin_ctzll(bits);
+	}
+
+	uint64_t above = w == 63 ? 0 : summary & (~(uint64_t) 0 << (w + 1));
+	if (above == 0) {return -1;}
+
+	w = __builtin_ctzll(above);
+	return w * 64 + __builtin_ctzll(words[w]);
+}
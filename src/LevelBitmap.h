@@ -0,0 +1,42 @@
+/*
+ * LevelBitmap
+ *
+ * A bitmap with one bit per priority level of an MLFQ, set iff that level's queue is not
+ * empty. Instead of walking every queue from the top priority down to find something to
+ * run, the Scheduler asks the bitmap for its highest set bit, which is a count leading
+ * zeros instruction on a 64 bit word.
+ *
+ * The bits are kept in two levels: words[w] holds levels 64w to 64w + 63, and bit w of
+ * summary is set iff words[w] is not zero. Finding the highest (or lowest) level is one
+ * CLZ (CTZ) on the summary and one on a word, so it costs the same for 4 priorities as
+ * for MAX_LEVELS.
+ *
+ * The owner keeps the bits in sync with its queues: set() after every push, clear()
+ * when a pop leaves a queue empty.
+ */
+
+#ifndef LEVELBITMAP_H_
+#define LEVELBITMAP_H_
+
+#include <vector>
+#include <stdint.h>
+
+class LevelBitmap {
+	public:
+		static const int MAX_LEVELS = 64 * 64;
+
+		 LevelBitmap();
+		 LevelBitmap(int numLevels); //all levels start cleared
+
+		void set  (int level);
+		void clear(int level);
+		bool test (int level);
+		int  highest();			//highest set level, or -1 if none
+		int  lowest(int from);	//lowest set level >= from, or -1 if none
+
+	private:
+		uint64_t summary;
+		std::vector<uint64_t> words;
+};
+
+#endif /* LEVELBITMAP_H_ */
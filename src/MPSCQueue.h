@@ -0,0 +1,84 @@
+/*
+ * MPSCQueue
+ *
+ * An unbounded lock-free queue for many producer threads and exactly one consumer
+ * thread (Dmitry Vyukov's intrusive MPSC design, with the nodes allocated here).
+ *
+ * push() never blocks and never fails: a producer swaps itself in as the new head with
+ * a single atomic exchange and then links the old head to it. pop() is only ever called
+ * by the consumer and returns false if the queue is empty. A producer that has swapped
+ * the head but not linked it yet makes the queue look empty for an instant; the consumer
+ * just picks the item up on its next pop().
+ *
+ * FIFO order is kept per producer. The queue always holds one dummy node, so head and
+ * tail are never NULL.
+ *
+ * Everything is in the header because it is a template.
+ */
+
+#ifndef MPSCQUEUE_H_
+#define MPSCQUEUE_H_
+
+#include <atomic>
+#include <utility>
+#include <stddef.h>
+
+template <typename T>
+class MPSCQueue {
+	public:
+		MPSCQueue() {
+			Node *dummy = new Node;
+			dummy->next.store(NULL, std::memory_order_relaxed);
+			head.store(dummy, std::memory_order_relaxed);
+			tail = dummy;
+		}
+
+		//Anything still queued is dropped
+		~MPSCQueue() {
+			T item;
+			while (pop(item)) {}
+			delete tail;
+		}
+
+		//Any thread may push
+		void push(const T &item) {
+			Node *n = new Node;
+			n->item = item;
+			n->next.store(NULL, std::memory_order_relaxed);
+
+			Node *prev = head.exchange(n, std::memory_order_acq_rel);
+			prev->next.store(n, std::memory_order_release);
+		}
+
+		//Only the consumer thread may pop. Returns false if nothing is ready
+		bool pop(T &item) {
+			Node *next = tail->next.load(std::memory_order_acquire);
+
+			if (next == NULL) {return false;}
+
+			item = std::move(next->item); //(an item may own memory, e.g. a vector)
+			delete tail;
+			tail = next; //next becomes the new dummy
+			return true;
+		}
+
+		//Only the consumer thread. True if pop() would return false right now
+		bool empty() {
+			return tail->next.load(std::memory_order_acquire) == NULL;
+		}
+
+	private:
+		struct Node {
+			std::atomic<Node*> next;
+			T item;
+		};
+
+		std::atomic<Node*> head; //producers push here
+		Node *tail;				 //consumer pops here (always the dummy)
+
+		//Not copyable
+		MPSCQueue(const MPSCQueue &);
+		MPSCQueue &operator=(const MPSCQueue &);
+};
+
+#endif /* MPSCQUEUE_H_ */
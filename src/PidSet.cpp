@@ -0,0 +1,79 @@
+/*
+ * PidSet.cpp
+ * see PidSet.h for details
+ */
+
+#include <string.h>
+#include "PidSet.h"
+
+using namespace std;
+
+PidSet::PidSet() {
+	size 	 = 0;
+	numPages = 0;
+}
+
+PidSet::~PidSet() {
+	for (unsigned i = 0; i < pages.size(); i++) {delete [] pages[i];}
+}
+
+void PidSet::insert(int pid) {
+	uint32_t bit  = (uint32_t) pid;
+	uint32_t page = bit / PAGE_BITS;
+	
+	if (page >= pages.size()) {pages.resize(page + 1, NULL);}
+	
+	if (pages[page] == NULL) {
+		pages[page] = new uint64_t[PAGE_BITS / 64];
+		memset(pages[page], 0, PAGE_BITS / 8);
+		numPages++;
+	}
+	
+	uint64_t &word = pages[page][bit % PAGE_BITS / 64];
+	uint64_t  mask = (uint64_t) 1 << (bit % 64);
+	
+	if (!(word & mask)) {
+		word |= mask;
+		size++;
+	}
+}
+
+bool PidSet::contains(int pid) {
+	uint32_t bit  = (uint32_t) pid;
+	uint32_t page = bit / PAGE_BITS;
+	
+	if (page >= pages.size() || pages[page] == NULL) {return false;}
+	
+	return (pages[page][bit % PAGE_BITS / 64] >> (bit % 64)) & 1;
+}
+
+long PidSet::get_size() {
+	return size;
+}
+
+size_t PidSet::get_pages() {
+	return pages.size();
+}
+
+const uint64_t *PidSet::get_page(size_t p) {
+	return p < pages.size() ? pages[p] : NULL;
+}
+
+void PidSet::set_page(size_t p, const uint64_t *bits) {
+	if (p >= pages.size()) {pages.resize(p + 1, NULL);}
+	
+	if (pages[p] == NULL) {
+		pages[p] = new uint64_t[PAGE_BITS / 64];
+		memset(pages[p], 0, PAGE_BITS / 8);
+		numPages++;
+	}
+	
+	for (unsigned w = 0; w < PAGE_BITS / 64; w++) {
+		size += __builtin_popcountll(bits[w]) - __builtin_popcountll(pages[p][w]);
+	}
+	memcpy(pages[p], bits, PAGE_BITS / 8);
+}
+
+size_t PidSet::get_bytes() {
+	return numPages * PAGE_BITS / 8 + pages.capacity() * sizeof(uint64_t*);
+}
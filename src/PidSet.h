@@ -0,0 +1,51 @@
+/*
+ * PidSet
+ *
+ * A set of PIDs kept as a bitmap, one bit per possible PID. The Scheduler keeps the PIDs
+ * of completed jobs here instead of their Jobs, so a long running instance remembers
+ * every job that ever completed (a dependency on one is already satisfied) for an eighth
+ * of a byte each.
+ *
+ * The bitmap is paged: a PID's bit is in page pid / PAGE_BITS, and a page is only
+ * allocated once a PID in it is inserted. Dense PIDs (1, 2, 3, ...) fill their pages, so
+ * 10 million of them take 1.25 MB; scattered ones cost at most a page each. A PID is
+ * taken as unsigned, so negative PIDs work too (at the far end of the directory).
+ */
+
+#ifndef PIDSET_H_
+#define PIDSET_H_
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+class PidSet {
+	public:
+		static const uint32_t PAGE_BITS = 1 << 15; //4 KB pages
+
+		 PidSet();
+		~PidSet();
+
+		void insert  (int pid);
+		bool contains(int pid);
+
+		long   get_size();  //PIDs in the set
+		size_t get_bytes(); //held from the heap
+		
+		//The bitmap a page (PAGE_BITS / 64 words) at a time, for checkpoints. get_page()
+		//is NULL for a page nothing was inserted in; set_page() replaces page p
+		size_t 			get_pages(); //pages in the directory, allocated or not
+		const uint64_t *get_page(size_t p);
+		void 			set_page(size_t p, const uint64_t *bits);
+
+	private:
+		std::vector<uint64_t*> pages; //NULL where no PID has been inserted yet
+		long 				   size;
+		size_t 				   numPages;
+
+		//Not copyable
+		PidSet(const PidSet &);
+		PidSet &operator=(const PidSet &);
+};
+
+#endif /* PIDSET_H_ */
@@ -12,13 +12,21 @@
 #include <vector>
 #include <thread>
 #include <chrono>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/wait.h>
 #include <curses.h>
 #include "Scheduler.h"
 #include "CursesHandler.h"
 
 using namespace std;
 
+const char Scheduler::CHECKPOINT_MAGIC[8] = {'S', 'B', 'C', 'K', 'P', 'T', '0', '4'};
+const char Scheduler::CHECKPOINT_END[8]   = {'S', 'B', 'C', 'K', 'E', 'N', 'D', '\n'};
+
 //////////////////////////////////////////////////////////////////////////////////////////
 // Constructing and destructing //////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -28,38 +36,101 @@ using namespace std;
 // time, and subsequent priorities have DIFF_QUANTUM less time than the priority beneath
 // them. There cannot be more priorities than BASE_QUANTUM / DIFF_QUANTUM.
 //
-Scheduler::Scheduler(int baseQuantum, int numQueues, bool varyQuanta, bool chainWeighting) {
+Scheduler::Scheduler(int baseQuantum, int numQueues, bool varyQuanta, bool chainWeighting,
+					 bool criticalPath, bool headless, int numCores, bool parallel,
+					 AdmissionQueue::Policy admitPolicy, int maxBypass)
+					 : win(headless), arena(chainWeighting || criticalPath),
+					   waitingOnMem(MAX_MEMORY, admitPolicy, maxBypass),
+					   timeline(Timeline::DEFAULT_EVENTS) {
 	if (numQueues > baseQuantum) {
 		throw logic_error("baseQuantum time must be larger than numQueues");
 	}
+	if (numQueues > LevelBitmap::MAX_LEVELS) {
+		throw logic_error("Too many priority levels");
+	}
+	if (numCores < 1) {
+		throw logic_error("There must be at least one core");
+	}
+	if (parallel && headless) {
+		throw logic_error("Parallel mode processes slices in realtime; it cannot be headless");
+	}
+	
+	//create a runs vector for every core
+	cores.resize(numCores);
+	for (unsigned i = 0; i < cores.size(); i++) {
+		cores[i].runs.resize(numQueues);
+		cores[i].nonEmpty  = LevelBitmap(numQueues);
+		cores[i].clock     = 0;
+		cores[i].busyTime  = 0;
+		cores[i].inFlight  = NULL;
+		cores[i].busy      = false;
+		cores[i].load      = 0;
+		cores[i].completed = 0;
+		cores[i].stolen    = 0;
+		cores[i].nextBoost = 0;
+	}
+	core = &cores[0];
+	
+	//one worker thread per core if slices are processed in parallel
+	pool = parallel ? new WorkerPool(numCores, JIFFIE_TIME, &timeline) : NULL;
+	feed = NULL;
+	
+	checkpointChild    = -1;
+	checkpointClock    = 0;
+	checkpointInterval = 0;
+	nextCheckpoint     = 0;
+	boostInterval 	   = 0;
 	
-	//create the runs vector
-	runs.resize(numQueues);
+	journal 		= NULL;
+	journalSequence = 0;
 	
+	this->NUM_QUEUES      = numQueues;
 	this->BASE_QUANTUM    = baseQuantum;
 	this->VARY_QUANTA     = varyQuanta;
-	this->CHAIN_WEIGHTING = chainWeighting;
+	this->CHAIN_WEIGHTING = chainWeighting || criticalPath;
+	this->CRITICAL_PATH   = criticalPath;
+	this->HEADLESS        = headless;
 
 	//The win object is already implicitly initialized with a Scheduler. We still need
 	//to call wireframe, which creates the UI skeleton
 	win.wireframe(numQueues);
-	win.mode_bar (varyQuanta, chainWeighting);
+	win.mode_bar (varyQuanta, CHAIN_WEIGHTING, criticalPath);
 	
 	//other Scheduler data get initialized
 	memoryUsed    = 0;
+	memoryPeak    = 0;
+	memoryJiffies = 0;
+	memoryClock   = 0;
 	runClock      = 0;
+	slices        = 0;
+	chainStamp    = 0;
 	totalComplete = 0;
 	
+	totalLatency         = 0;
+	totalTurnaround      = 0;
+	totalResponse        = 0;
+	totalTurnPerBurst    = 0;
+	totalLatencyPerBurst = 0;
+	byLevel.resize(numQueues);
+	bySize.resize(NUM_SIZE_CLASSES);
+	
 	win.console_bar("Initialization successful");
 	win.console_bar(1, "Base quantum: %d",     baseQuantum);
 	win.console_bar(2, "Number of queues: %d", numQueues);
+	win.console_bar(3, "Number of cores: %d",  numCores);
 }
 
+//Every job ever made is freed in bulk by the arena's destructor, after this
 Scheduler::~Scheduler() {
-	//Find every job ever allocated via the jobs hash table, and free that job from memory
-	//Note: the JobHashTable has it's own destructor that frees the "buckets" in the array
-	//But Scheduler always originally allocates new jobs when they are created
-	jobs.destroy_all_jobs();
+	delete pool; //join the workers first; in-flight slices still point at jobs
+	delete feed;
+	
+	if (checkpointChild != -1) {waitpid(checkpointChild, NULL, 0);} //let it finish
+	
+	if (journal != NULL && !journal->close()) { //commits whatever is still pending
+		cerr << "Could not write everything to the journal" << endl;
+	}
+	delete journal;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -76,7 +147,18 @@ void Scheduler::run() {
 	win.paused_bar(true);
 	
 	while (!exit) {
-		if (!paused) { //if not paused, run a process iteration
+		ingest(); //never blocks
+		tend_checkpoints();
+		
+		if (!paused && pool != NULL) { //parallel: finish, admit, then dispatch
+			collect_slices();
+			move_from_waiting();
+			
+			if (!dispatch_slices()) {
+				win.clear_console();
+				win.console_bar("No processes currently running");
+			}
+		} else if (!paused) { //if not paused, run a process iteration
 			move_from_waiting();
 			
 			if (!find_next_priority()) {
@@ -87,7 +169,7 @@ void Scheduler::run() {
 			}
 		}
 		
-		if ((inputChar = getch()) != ERR) { //check if the user inputted anything
+		if ((inputChar = win.get_key()) != ERR) { //check if the user inputted anything
 			win.paused_bar(true);
 			win.blocking_on(); //wait for user input when expected
 			main_menu_input(inputChar); //process the request
@@ -96,7 +178,572 @@ void Scheduler::run() {
 			win.paused_bar(paused);
 		}
 	}
-	win.~CursesHandler(); //Destructor only gets called if explicit (NCurses is weird...)
+	win.close(); //give the terminal back now, not when the Scheduler goes
+}
+
+bool Scheduler::follow(const char *path) {
+	delete feed;
+	feed = new JobFeed();
+	
+	if (!feed->open(path)) {
+		delete feed;
+		feed = NULL;
+	}
+	return feed != NULL;
+}
+
+void Scheduler::submit(int pid, int execTime, int resources, const vector<int> &deps) {
+	TraceReader::Record r;
+	
+	r.line      = 0;
+	r.pid       = pid;
+	r.execTime  = execTime;
+	r.resources = resources;
+	r.deps      = deps;
+	submitted.push(r);
+}
+
+//Make a job from everything submitted since the last call (at most MAX_SUBMIT_BATCH, so
+//a flood of submissions cannot hold up the MLFQ), then from every complete record that
+//has arrived on the feed. Called between slices by run(), so jobs stream in while the
+//MLFQ keeps going (paused or not); neither source ever blocks
+void Scheduler::ingest() {
+	TraceReader::Record r;
+	
+	for (int i = 0; i < MAX_SUBMIT_BATCH && submitted.pop(r); i++) {
+		const char *error = make_job_from_record(r);
+		
+		if (error != NULL && HEADLESS) {
+			cerr << "Submitted job #" << r.pid << ": " << error << endl;
+		} else if (error != NULL) {
+			win.feed_bar("Submitted job #%d: " + string(error), r.pid);
+		}
+	}
+	
+	if (feed == NULL) {return;}
+	
+	feedRecords.clear();
+	feedErrors.clear();
+	
+	if (feed->poll(feedRecords, feedErrors) == 0 && feedErrors.empty()) {return;}
+	
+	int made = 0;
+	for (unsigned i = 0; i < feedRecords.size(); i++) {
+		const char *error = make_job_from_record(feedRecords[i]);
+		
+		if (error == NULL) {made++;}
+		else 			   {win.feed_bar("Feed line %d: " + string(error),
+										 feedRecords[i].line);}
+	}
+	for (unsigned i = 0; i < feedErrors.size(); i++) {
+		win.feed_bar("Feed line %d: " + feedErrors[i].message, feedErrors[i].line);
+	}
+	feed->ingested(made);
+	output_feed_status();
+}
+
+//Same iteration as run() but with no menu: every job in inFile is loaded up front and
+//the loop ends as soon as no process is left in the MLFQ. Because HEADLESS skips the
+//sleep in process_job(), the runClock is purely virtual and a trace replays as fast as
+//the CPU allows. fast_forward() additionally jumps over uneventful round robin rounds
+void Scheduler::run_headless(TraceReader &trace) {
+	load_jobs(trace);
+	
+	vector<TraceReader::Error> &errors = trace.get_errors();
+	for (unsigned i = 0; i < errors.size() && i < MAX_LOAD_ERRORS; i++) {
+		cerr << "Error reading file: " << (trace.is_binary() ? "record " : "line ")
+			 << errors[i].line << ": " << errors[i].message << endl;
+	}
+	if (errors.size() > MAX_LOAD_ERRORS) {
+		cerr << "... and " << errors.size() - MAX_LOAD_ERRORS << " more errors" << endl;
+	}
+	
+	int cooldown = 0; //slices left before fast_forward() is worth trying again
+	
+	ingest(); //anything submit()ted before the run
+	move_from_waiting();
+	
+	while (find_next_priority()) {
+		if (cooldown > 0) {cooldown--;}
+		else 			  {cooldown = fast_forward();}
+		
+		process_job();
+		ingest();
+		tend_checkpoints();
+		move_from_waiting();
+	}
+	
+	reap_checkpoint(true); //report how the last one went
+}
+
+//No fast_forward() here: it could jump far past clock. A job submitted after this
+//returns is inserted at runClock, i.e. (to within a slice) when it arrived
+void Scheduler::run_headless_until(int clock) {
+	ingest();
+	move_from_waiting();
+	
+	while (find_next_priority() && core->clock < clock) {
+		process_job();
+		ingest();
+		tend_checkpoints();
+		move_from_waiting();
+	}
+	
+	if (runClock < clock) { //nothing was left to run
+		use_memory(0);
+		runClock = clock;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// Checkpoints and the journal ///////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+//The only pause is fork() itself, which copies the page tables and nothing else. The
+//child then sees the state exactly as it was while the parent goes on changing its own
+//copy, and _exit()s without running any destructor (NCurses, the worker threads and
+//the arena all belong to the parent). In parallel mode a slice may be in flight: its
+//time is already taken off the job, which is checkpointed at the front of its queue
+//as if the slice had not ended yet
+bool Scheduler::checkpoint(const char *path) {
+	if (!reap_checkpoint(false)) {return false;} //one at a time
+	
+	pid_t child = fork();
+	
+	if (child == 0) {_exit(write_checkpoint(path) ? 0 : 1);}
+	if (child < 0)  {return false;}
+	
+	checkpointChild = child;
+	checkpointClock = runClock;
+	return true;
+}
+
+void Scheduler::checkpoint_every(const char *path, int interval) {
+	checkpointPath     = path;
+	checkpointInterval = interval;
+	nextCheckpoint     = runClock + interval;
+}
+
+//The first boost of each core is due at the first multiple of interval its clock
+//reaches
+void Scheduler::boost_every(int interval) {
+	boostInterval = interval;
+	
+	for (unsigned i = 0; i < cores.size() && interval > 0; i++) {
+		cores[i].nextBoost = (cores[i].clock + interval - 1) / interval * interval;
+	}
+}
+
+//Called between slices. A periodic checkpoint that comes due while the last one is still
+//being written is skipped rather than waited for. Headless runs only look at the child
+//when a checkpoint is due, so they do not pay a system call per slice
+void Scheduler::tend_checkpoints() {
+	if (checkpointChild != -1 && !HEADLESS) {reap_checkpoint(false);}
+	
+	if (checkpointInterval > 0 && runClock >= nextCheckpoint) {
+		if (!checkpoint(checkpointPath.c_str())) {
+			if (HEADLESS) {cerr << "Checkpoint skipped at jiffy " << runClock << endl;}
+			else 		  {win.feed_bar("Checkpoint skipped at jiffy %d", runClock);}
+		}
+		nextCheckpoint = runClock + checkpointInterval;
+	}
+}
+
+//Collect the child writing the last checkpoint and report how it went. Return false if
+//it is still writing (only if wait is false)
+bool Scheduler::reap_checkpoint(bool wait) {
+	if (checkpointChild == -1) {return true;}
+	
+	int   status;
+	pid_t done = waitpid(checkpointChild, &status, wait ? 0 : WNOHANG);
+	
+	if (done == 0) {return false;}
+	
+	bool written = done == checkpointChild && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	checkpointChild = -1;
+	
+	if (HEADLESS && !written) {
+		cerr << "Cannot write the checkpoint of jiffy " << checkpointClock << endl;
+	} else if (!HEADLESS) {
+		win.feed_bar(written ? "Checkpoint of jiffy %d written"
+							 : "Cannot write the checkpoint of jiffy %d", checkpointClock);
+	}
+	return true;
+}
+
+//Append list's jobs by their numbers in the checkpoint
+static void put_list(CheckpointWriter &out, JobList &list, vector<int32_t> &number) {
+	out.put_int(list.size());
+	for (unsigned i = 0; i < list.size(); i++) {out.put_int(number[list[i]]);}
+}
+
+//Append every histogram of group: its min, max and sum, then its buckets (count, then
+//the counts)
+static void put_histograms(CheckpointWriter &out, CompletionHistograms &group) {
+	for (int m = 0; m < CompletionHistograms::NUM_METRICS; m++) {
+		Histogram &h = group.metric[m];
+		const vector<uint64_t> &buckets = h.get_buckets();
+		
+		out.put_long  (h.get_min());
+		out.put_long  (h.get_max());
+		out.put_double(h.get_sum());
+		out.put_int   (buckets.size());
+		if (!buckets.empty()) {out.put_bytes(&buckets[0], buckets.size() * 8);}
+	}
+}
+
+//...and read them back. False if the checkpoint is damaged
+static bool get_histograms(CheckpointReader &in, CompletionHistograms &group) {
+	vector<uint64_t> buckets;
+	
+	for (int m = 0; m < CompletionHistograms::NUM_METRICS; m++) {
+		long long min = in.get_long();
+		long long max = in.get_long();
+		double 	  sum = in.get_double();
+		int32_t   n   = in.get_int();
+		
+		if (in.failed() || n < 0 || (uint64_t) n > in.get_remaining() / 8) {return false;}
+		buckets.resize(n);
+		if (n > 0) {memcpy(&buckets[0], in.get_bytes(n * 8), n * 8);}
+		group.metric[m].restore(buckets, min, max, sum);
+	}
+	return true;
+}
+
+//Runs in the checkpoint's child process (see checkpoint()), so it can take its time.
+//Jobs are numbered in the order they are written and every reference to a job (an edge
+//or a place in a queue) is written as its number. In order:
+//
+//  magic, the settings (QUEUENUM, cores, BASE, -q, -c), clocks, memory and statistics,
+//  and the last journal entry this state includes
+//  per core: clock, busy time, jobs completed and jobs stolen
+//  the number of jobs, then per job: PID, status, execTime left, resources, the four
+//  JobStats clock times, and (-c or -p only) its longest chain
+//  per job: its dependencies, then its successors (count, then numbers)
+//  per core, per priority: count, then the jobs from front to back
+//  the admission queue's bypass count, then the jobs waiting on memory, oldest first
+//  completed PIDs: pages in use, then per page its index and bits
+//  the histograms: over all jobs, per level, then per size class
+//  end marker
+bool Scheduler::write_checkpoint(const char *path) {
+	CheckpointWriter out;
+	vector<Job*>     all;
+	vector<Job*>     waiting;
+	vector<int32_t>  number; //by job id
+	
+	if (!out.open(path)) {return false;}
+	
+	jobs.collect(all);
+	waitingOnMem.collect(waiting);
+	for (unsigned i = 0; i < all.size(); i++) {
+		if (all[i]->get_id() >= number.size()) {number.resize(all[i]->get_id() + 1);}
+		number[all[i]->get_id()] = i;
+	}
+	
+	int32_t settings[] = {NUM_QUEUES, (int32_t) cores.size(), BASE_QUANTUM, VARY_QUANTA,
+						  CHAIN_WEIGHTING + CRITICAL_PATH, runClock, memoryUsed,
+						  memoryPeak, memoryClock, totalComplete};
+	
+	out.put_bytes(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+	for (unsigned i = 0; i < sizeof(settings) / sizeof(settings[0]); i++) {
+		out.put_int(settings[i]);
+	}
+	out.put_long  (totalLatency);
+	out.put_long  (totalTurnaround);
+	out.put_long  (totalResponse);
+	out.put_long  (memoryJiffies);
+	out.put_long  (slices);
+	out.put_long  (journal != NULL ? journal->get_sequence() : journalSequence);
+	out.put_double(totalTurnPerBurst);
+	out.put_double(totalLatencyPerBurst);
+	
+	for (unsigned c = 0; c < cores.size(); c++) {
+		out.put_int(cores[c].clock);
+		out.put_int(cores[c].busyTime);
+		out.put_int(cores[c].completed);
+		out.put_int(cores[c].stolen);
+	}
+	
+	out.put_long(all.size());
+	for (unsigned i = 0; i < all.size(); i++) {
+		Job 	 *j 	 = all[i];
+		JobStats &s 	 = arena.stats(j);
+		bool 	  latent = j->get_status() == Job::LATENT; //no execTime or resources yet
+		
+		out.put_int(j->get_pid());
+		out.put_int(j->get_status());
+		out.put_int(latent ? 0 : j->get_exec_time());
+		out.put_int(latent ? 0 : j->get_resources());
+		out.put_int(s.originalExecTime);
+		out.put_int(s.clockInsert);
+		out.put_int(s.clockBegin);
+		out.put_int(s.clockComplete);
+		if (CHAIN_WEIGHTING) {out.put_long(arena.chain(j).longestChain);}
+	}
+	for (unsigned i = 0; i < all.size(); i++) {
+		put_list(out, arena.graph(all[i]).dependencies, number);
+		put_list(out, arena.graph(all[i]).successors,   number);
+	}
+	
+	for (unsigned c = 0; c < cores.size(); c++) {
+		for (int p = 0; p < NUM_QUEUES; p++) {
+			JobQueue &q = cores[c].runs[p];
+			
+			out.put_int(q.size());
+			for (Job *j = q.empty() ? NULL : q.front(); j != NULL; j = q.next(j)) {
+				out.put_int(number[j->get_id()]);
+			}
+		}
+	}
+	
+	out.put_int(waitingOnMem.get_bypassed());
+	out.put_int(waiting.size());
+	for (unsigned i = 0; i < waiting.size(); i++) {
+		out.put_int(number[waiting[i]->get_id()]);
+	}
+	
+	int32_t pages = 0;
+	for (size_t p = 0; p < completed.get_pages(); p++) {
+		if (completed.get_page(p) != NULL) {pages++;}
+	}
+	out.put_int(pages);
+	for (size_t p = 0; p < completed.get_pages(); p++) {
+		if (completed.get_page(p) == NULL) {continue;}
+		out.put_int(p);
+		out.put_bytes(completed.get_page(p), PidSet::PAGE_BITS / 8);
+	}
+	
+	put_histograms(out, allJobs);
+	for (int p = 0; p < NUM_QUEUES; p++) 		  {put_histograms(out, byLevel[p]);}
+	for (int k = 0; k < NUM_SIZE_CLASSES; k++) {put_histograms(out, bySize[k]);}
+	
+	out.put_bytes(CHECKPOINT_END, sizeof(CHECKPOINT_END));
+	return out.close();
+}
+
+//Read write_checkpoint()'s format back in one pass: jobs are made in the order they were
+//written, so a number is an index into byNumber, and lists and queues are refilled in
+//their old order. Anything out of range means the file is damaged
+const char *Scheduler::restore(const char *path) {
+	static const char *DAMAGED = "The checkpoint is truncated or damaged";
+	CheckpointReader in;
+	
+	if (!jobs.is_empty() || completed.get_size() > 0 || runClock > 0) {
+		return "Can only restore into a new scheduler";
+	}
+	if (!in.open(path)) {return "Cannot open the checkpoint";}
+	
+	const char *magic = in.get_bytes(sizeof(CHECKPOINT_MAGIC));
+	if (magic == NULL || memcmp(magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+		return "Not a checkpoint";
+	}
+	
+	if (in.get_int() != NUM_QUEUES || in.get_int() != (int32_t) cores.size() ||
+		in.get_int() != BASE_QUANTUM || in.get_int() != VARY_QUANTA ||
+		in.get_int() != CHAIN_WEIGHTING + CRITICAL_PATH) {
+		return "The checkpoint is of a different BASE, QUEUENUM, -c, -p, -q or -n";
+	}
+	
+	runClock      		 = in.get_int();
+	memoryUsed	  		 = in.get_int();
+	memoryPeak	  		 = in.get_int();
+	memoryClock	  		 = in.get_int();
+	totalComplete 		 = in.get_int();
+	totalLatency  		 = in.get_long();
+	totalTurnaround 	 = in.get_long();
+	totalResponse 		 = in.get_long();
+	memoryJiffies 		 = in.get_long();
+	slices 		  		 = in.get_long();
+	journalSequence		 = in.get_long();
+	totalTurnPerBurst 	 = in.get_double();
+	totalLatencyPerBurst = in.get_double();
+	
+	for (unsigned c = 0; c < cores.size(); c++) {
+		cores[c].clock 	   = in.get_int();
+		cores[c].busyTime  = in.get_int();
+		cores[c].completed = in.get_int();
+		cores[c].stolen    = in.get_int();
+	}
+	
+	int64_t numJobs = in.get_long();
+	if (in.failed() || numJobs < 0 || (uint64_t) numJobs > in.get_remaining() / 32) {
+		return DAMAGED;
+	}
+	
+	vector<Job*> byNumber(numJobs);
+	for (int64_t i = 0; i < numJobs; i++) {
+		int pid 	  = in.get_int();
+		int status 	  = in.get_int();
+		int execTime  = in.get_int();
+		int resources = in.get_int();
+		
+		if (status < Job::LATENT || status > Job::COMPLETE || execTime < 0 ||
+			resources < 0 || resources > MAX_MEMORY || jobs.find(pid) != NULL) {
+			return DAMAGED;
+		}
+		
+		Job 	 *j = byNumber[i] = arena.make(pid);
+		JobStats &s = arena.stats(j);
+		
+		jobs.insert(j);
+		if (status != Job::LATENT) {
+			j->prepare(execTime, resources);
+			j->set_status((Job::Status) status);
+		}
+		s.originalExecTime = in.get_int();
+		s.clockInsert 	   = in.get_int();
+		s.clockBegin 	   = in.get_int();
+		s.clockComplete    = in.get_int();
+		if (CHAIN_WEIGHTING) {arena.chain(j).longestChain = in.get_long();}
+	}
+	
+	for (int64_t i = 0; i < numJobs; i++) {
+		JobList *lists[] = {&arena.graph(byNumber[i]).dependencies,
+							&arena.graph(byNumber[i]).successors};
+		
+		for (int l = 0; l < 2; l++) {
+			for (int32_t k = in.get_int(); k > 0; k--) {
+				int32_t n = in.get_int();
+				
+				if (n < 0 || n >= numJobs) {return DAMAGED;}
+				arena.append(*lists[l], byNumber[n]->get_id());
+			}
+		}
+	}
+	
+	for (unsigned c = 0; c < cores.size(); c++) {
+		for (int p = 0; p < NUM_QUEUES; p++) {
+			for (int32_t k = in.get_int(); k > 0; k--) {
+				int32_t n = in.get_int();
+				
+				if (n < 0 || n >= numJobs || byNumber[n]->get_queue() != NULL ||
+					(byNumber[n]->get_status() != Job::RUNNING &&
+					 byNumber[n]->get_status() != Job::COMPLETE)) {
+					return DAMAGED;
+				}
+				push_run(&cores[c], p, byNumber[n]);
+				cores[c].load++;
+			}
+		}
+	}
+	
+	int bypassed = in.get_int();
+	for (int32_t k = in.get_int(); k > 0; k--) {
+		int32_t n = in.get_int();
+		
+		if (n < 0 || n >= numJobs || byNumber[n]->get_queue() != NULL ||
+			byNumber[n]->get_status() != Job::WAITING) {
+			return DAMAGED;
+		}
+		waitingOnMem.push(byNumber[n]);
+	}
+	waitingOnMem.set_bypassed(bypassed);
+	
+	vector<uint64_t> page(PidSet::PAGE_BITS / 64);
+	for (int32_t k = in.get_int(); k > 0; k--) {
+		int32_t 	p 	 = in.get_int();
+		const char *bits = in.get_bytes(PidSet::PAGE_BITS / 8);
+		
+		//PIDs are 32 bits, so there are no more pages than 2^32 / PAGE_BITS
+		if (bits == NULL || (uint32_t) p >= (1ULL << 32) / PidSet::PAGE_BITS) {
+			return DAMAGED;
+		}
+		memcpy(&page[0], bits, PidSet::PAGE_BITS / 8);
+		completed.set_page((uint32_t) p, &page[0]);
+	}
+	
+	bool histograms = get_histograms(in, allJobs);
+	for (int p = 0; p < NUM_QUEUES; p++) {
+		histograms = histograms && get_histograms(in, byLevel[p]);
+	}
+	for (int k = 0; k < NUM_SIZE_CLASSES; k++) {
+		histograms = histograms && get_histograms(in, bySize[k]);
+	}
+	
+	const char *end = in.get_bytes(sizeof(CHECKPOINT_END));
+	if (!histograms || end == NULL ||
+		memcmp(end, CHECKPOINT_END, sizeof(CHECKPOINT_END)) != 0 || !in.at_end()) {
+		return DAMAGED;
+	}
+	
+	nextCheckpoint = runClock + checkpointInterval;
+	win.feed_bar("Restored %d jobs from a checkpoint", (int) numJobs);
+	return NULL;
+}
+
+//Entries up to journalSequence are already in the state (it was restored from a
+//checkpoint taken after them). What was running when the instance died loses the work
+//it did since the state was saved, but not the time: every core picks up at the last
+//clock in the journal
+const char *Scheduler::journal_to(const char *path, int interval) {
+	JournalReader  in;
+	Journal::Entry e;
+	int replayed = 0;
+	
+	if (journal != NULL) {return "Already journaling";}
+	if (!in.open(path))  {return "Cannot read the journal";}
+	
+	while (in.next(e)) {
+		if (e.sequence <= journalSequence) {continue;}
+		
+		replay(e);
+		journalSequence = e.sequence;
+		replayed++;
+	}
+	for (unsigned c = 0; c < cores.size(); c++) {
+		if (cores[c].clock < runClock) {cores[c].clock = runClock;}
+	}
+	
+	journal = new Journal();
+	if (!journal->open(path, in.get_valid_bytes(), journalSequence, interval)) {
+		delete journal;
+		journal = NULL;
+		return "Cannot write to the journal";
+	}
+	
+	if (replayed > 0) {win.feed_bar("Replayed %d journal entries", replayed);}
+	return NULL;
+}
+
+//Do again what an entry says was done, at the clock it was done at. An entry whose job
+//is no longer in a state it applies to is skipped
+void Scheduler::replay(Journal::Entry &e) {
+	if (e.clock > runClock) {
+		use_memory(0);
+		runClock = e.clock;
+	}
+	
+	Job *j = jobs.find(e.record.pid);
+	
+	if (e.type == Journal::INSERT) {
+		make_job_from_record(e.record);
+		return;
+	}
+	if (e.type == Journal::CANCEL) {
+		if (j != NULL) {cancel_subgraph(j);}
+		return;
+	}
+	if (j == NULL || j->get_status() == Job::LATENT) {return;}
+	
+	//A job checkpointed in the middle of its last slice (parallel mode) is still queued
+	//as a running job
+	if (j->get_status() == Job::COMPLETE) {j->set_status(Job::RUNNING);}
+	
+	if (e.type == Journal::KILL) {
+		kill(j);
+	} else {
+		JobStats &s = arena.stats(j);
+		
+		unqueue(j);
+		detach(j); //in case the journal is missing the completion of a dependency
+		s.clockInsert   = e.clockInsert;
+		s.clockBegin    = e.clockBegin;
+		s.clockComplete = e.clock;
+		
+		current = j;
+		retire(&cores[e.core >= 0 && e.core < (int) cores.size() ? e.core : 0],
+			   e.level >= 0 && e.level < NUM_QUEUES ? e.level : NUM_QUEUES - 1);
+	}
 }
 
 
@@ -110,132 +757,598 @@ void Scheduler::run() {
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 
-//sets priority to the highest priority that is not empty, and set current to the next
-//jobs to be processed. Return false if there are no processes to run.
+//Sets core to the busy core with the earliest clock, priority to that core's highest
+//priority that is not empty, and current to the next job to be processed. Idle cores
+//get a chance to steal work first. Return false if there are no processes to run.
 bool Scheduler::find_next_priority() {
-	priority = runs.size() - 1;
-		
-	while (priority >= 0) {
-		if (!runs[priority].empty()) {		
-			current = runs[priority].front();
-			break;
+	steal_for_idle_cores();
+	
+	core = NULL;
+	for (unsigned i = 0; i < cores.size(); i++) {
+		if (cores[i].load > 0 && (core == NULL || cores[i].clock < core->clock)) {
+			core = &cores[i];
 		}
-		priority--;
+	}
+	
+	if (core == NULL) {
+		core = &cores[0]; //keep core valid for output_status and fast_forward
+		return false;
+	}
+	
+	return pick_from_core(core);
+}
+
+//Sets core to c, priority to c's highest priority that is not empty, and current to
+//the job at the front of that priority. Return false if c has nothing to run.
+//The nonEmpty bitmap answers this with a count leading zeros instead of walking the
+//(mostly empty, with many priorities) queues from the top down. A boost that is due
+//happens first
+bool Scheduler::pick_from_core(Core *c) {
+	core = c;
+	if (boostInterval > 0 && core->clock >= core->nextBoost) {boost(core);}
+	
+	priority = core->nonEmpty.highest();
+	
+	if (priority != -1) {
+		current = core->runs[priority].front();
 	}
 	
 	return (priority != -1);
 }
+
+//The priority boost: move every job on c to the back of its top priority, the highest
+//priorities first, so jobs keep their order within a priority. Each priority is spliced
+//over whole (see JobQueue::splice()), so a boost takes O(NUM_QUEUES) whatever the number
+//of jobs
+void Scheduler::boost(Core *c) {
+	int top   = NUM_QUEUES - 1;
+	int moved = 0;
+	
+	for (int p = top - 1; p >= 0; p--) {
+		if (!c->nonEmpty.test(p)) {continue;}
 		
-//add from waitingOnMem queue until MAX_MEMORY is reached. This can be a problem
-//because it always takes from the front of the queue; it does not scroll through
-//with a greedy algorithm looking for all jobs that are less than max. So if one
-//job uses all of memory there is a huge problem.
-//
-//This is sometimes called the "convoy effect" and I am working on figuring
-//out a cool solution...	
+		moved += c->runs[p].size();
+		c->runs[top].splice(c->runs[p]);
+		c->nonEmpty.clear(p);
+	}
+	if (moved > 0) {
+		c->nonEmpty.set(top);
+		timeline.record(Timeline::BOOST, c->clock, c - &cores[0], top, moved, 0, 0);
+		win.feed_bar("Boosted %d jobs to the top priority", moved);
+	}
+	
+	c->nextBoost = (c->clock / boostInterval + 1) * boostInterval;
+}
+
+//Every push to and removal from a core's runs goes through these two, so the core's
+//nonEmpty bitmap always matches its queues
+void Scheduler::push_run(Core *c, int level, Job *j) {
+	c->runs[level].push(j);
+	c->nonEmpty.set(level);
+}
+
+void Scheduler::remove_run(Core *c, int level, Job *j) {
+	c->runs[level].remove(j);
+	
+	if (c->runs[level].empty()) {
+		c->nonEmpty.clear(level);
+	}
+}
+
+//Newly started jobs go to the core with the fewest jobs in its MLFQ (the lowest
+//numbered core wins a tie, so a single core Scheduler always picks core 0)
+Scheduler::Core *Scheduler::least_loaded_core() {
+	Core *best = &cores[0];
+	
+	for (unsigned i = 1; i < cores.size(); i++) {
+		if (cores[i].load < best->load) {
+			best = &cores[i];
+		}
+	}
+	return best;
+}
+
+//Every idle core takes one job from the busiest core, as long as the busiest core has
+//a job to spare. The job is taken from the tail of the victim's lowest priority queue
+//that is not empty: that is the job the victim would get to last, and stealing it does
+//not disturb the job the victim is about to run. The job keeps its priority. The thief
+//cannot start the job before the victim's clock, so its own clock catches up to it.
+//A job whose slice is in flight on a worker thread is never stolen
+void Scheduler::steal_for_idle_cores() {
+	if (cores.size() == 1) {return;}
+	
+	for (unsigned i = 0; i < cores.size(); i++) {
+		if (cores[i].load > 0) {continue;}
+		
+		Core *victim = &cores[0];
+		for (unsigned v = 1; v < cores.size(); v++) {
+			if (cores[v].load > victim->load) {
+				victim = &cores[v];
+			}
+		}
+		
+		if (victim->load < 2) {return;} //nobody has anything to spare
+		
+		int level = victim->nonEmpty.lowest(0);
+		while (victim->runs[level].back() == victim->inFlight) {
+			level = victim->nonEmpty.lowest(level + 1);
+		}
+		
+		Job *j = victim->runs[level].back();
+		remove_run(victim, level, j);
+		victim->load--;
+		
+		push_run(&cores[i], level, j);
+		cores[i].load++;
+		cores[i].stolen++;
+		if (cores[i].clock < victim->clock) {
+			cores[i].clock = victim->clock;
+		}
+		win.feed_bar("Job #%d: stolen by an idle core", j->get_pid());
+	}
+}
+		
+//Admit jobs from waitingOnMem for as long as the admission policy finds one that fits in
+//the memory left. With the FIFO policy that is the front of the line or nothing, so one
+//job that needs most of memory holds up every job behind it -- the "convoy effect." The
+//backfilling policies admit jobs around it (see AdmissionQueue.h)
 void Scheduler::move_from_waiting() {
-	while (!waitingOnMem.empty() && 
-		    waitingOnMem.front()->get_resources() + memoryUsed <= MAX_MEMORY) {
-				start_processing(waitingOnMem.front());
-				waitingOnMem.pop();
+	Job *j;
+	
+	while ((j = waitingOnMem.pop_fitting(MAX_MEMORY - memoryUsed)) != NULL) {
+		start_processing(j);
 	}
 }
 
+//Change memoryUsed by amount (negative to free), first adding the memory in use since the
+//last change to memoryJiffies for the utilization statistic
+void Scheduler::use_memory(int amount) {
+	memoryJiffies += (long long) memoryUsed * (runClock - memoryClock);
+	memoryClock    = runClock;
+	memoryUsed    += amount;
+	
+	if (memoryUsed > memoryPeak) {memoryPeak = memoryUsed;}
+}
+
 //Call when a job is ready to process through the multilevel feedback queues. Set
 //status from Job::WAITING to RUNNING, push it to the highest priority queue, and add the 
-//resources to memory
+//resources to memory. The job goes
+//on the least loaded core. An idle core's clock is brought up to the present first
 void Scheduler::start_processing(Job *new_process) {
-	win.feed_bar("Job #%d: Began processing", waitingOnMem.front()->get_pid()); //print
+	Core *c = least_loaded_core();
+	
+	win.feed_bar("Job #%d: Began processing", new_process->get_pid()); //print
 	new_process->set_status(Job::RUNNING);
-	runs[runs.size() - 1].push(new_process); //add to the highest level priority
-	memoryUsed += new_process->get_resources(); //add resources to memory
-	new_process->set_clock_begin(runClock); //record runClock time (for statistics)
+	push_run(c, NUM_QUEUES - 1, new_process); //add to the highest level priority
+	c->load++;
+	if (c->clock < runClock) {c->clock = runClock;}
+	use_memory(new_process->get_resources()); //add resources to memory
+	arena.stats(new_process).clockBegin = runClock; //record runClock time (for statistics)
+	
+	timeline.record(Timeline::ADMIT, runClock, c - &cores[0], NUM_QUEUES - 1,
+					new_process->get_pid(), new_process->get_resources(), 0);
+	timeline.record(Timeline::MEMORY, runClock, 0, 0, 0, memoryUsed,
+					waitingOnMem.size());
+}
+
+//Called when current has finished processing in it's allocated time slice. (Execute
+//similar tasks to above)
+void Scheduler::complete_processing() {
+	win.feed_bar("Job #%d: completed", current->get_pid()); //print to feed
+	use_memory(-current->get_resources()); //take resources off memory
+	timeline.record(Timeline::MEMORY, core->clock, 0, 0, 0, memoryUsed,
+					waitingOnMem.size());
+	remove_run(core, priority, current); //pop from the queue
+	core->load--;
+	arena.stats(current).clockComplete = core->clock; //record core time (for statistics)
+	retire(core, priority);
+}
+
+//current, out of every queue with its clock times recorded, completed on core c at
+//level: count it, release its successors and forget it (also what replaying a
+//completion does)
+void Scheduler::retire(Core *c, int level) {
+	JobStats &s = arena.stats(current);
+	
+	if (journal != NULL) {
+		journal->append_complete(s.clockComplete, current->get_pid(), c - &cores[0],
+								 level, s.clockInsert, s.clockBegin);
+	}
+	
+	timeline.record(Timeline::COMPLETE, s.clockComplete, c - &cores[0], level,
+					current->get_pid(), 0, 0);
+	
+	c->completed++;
+	totalComplete++; //increment the Job::COMPLETE counter (used for statistics)
+	update_stats(level); //update the statistics bar
+	update_successors();//remove dependents from all successors & run eligible successors
+	
+	//All that is left to remember about current is that its PID completed. Its slot and
+	//lists go to the next job made
+	jobs.remove(current->get_pid());
+	completed.insert(current->get_pid());
+	arena.release(current);
+	current = NULL;
+}
+
+//Given that current and priority are already set, determine the time slice and run
+//the clock / sleep / decrement execTime by that slice. If the job finished, call
+//complete_processing(), otherwise, move it to the appropriate place in the MLFQ
+void Scheduler::process_job() {
+	int slice = run_slice();
+	
+	if (!HEADLESS) {
+		std::this_thread::sleep_for(std::chrono::microseconds(JIFFIE_TIME * slice));
+	}
+	
+	end_slice(slice);
+}
+
+//First half of process_job(): determine the time slice, decrement execTime, and run
+//the core's clock. Return the slice
+int Scheduler::run_slice() {
+	int slice = slice_for(current, priority);
+		
+	//"run" current (i.e. decrement the job's remaining execTime) for a time slice that
+	//is as long as current's priority's time quantum will allow OR until complete
+	int used = current->decrease_time(slice);
+	
+	if (pool == NULL) { //else the worker records it, see dispatch_slices()
+		timeline.record(Timeline::SLICE, core->clock, core - &cores[0], priority,
+						current->get_pid(), used, 0);
+	}
+	
+	slices++;
+	core->clock    += used;
+	core->busyTime += used;
+	if (core->clock > runClock) {runClock = core->clock;}
+	
+	return slice;
+}
+
+//Second half of process_job(), once the slice has been "processed": current is still
+//at the front of runs[priority] on its core
+void Scheduler::end_slice(int slice) {
+	if (!HEADLESS) {
+		output_status(slice); //update the status bar
+	}
+
+	if (current->get_status() == Job::COMPLETE) { //completed during slice
+		complete_processing();
+	} else { //job gets bumped down a priority unless already in round robin base
+		remove_run(core, priority, current);
+		
+		if (priority > 0) {
+			timeline.record(Timeline::DEMOTE, core->clock, core - &cores[0], priority,
+							current->get_pid(), 0, priority - 1);
+			priority--;
+		}
+		push_run(core, priority, current);
+	}
+}
+
+//Parallel mode: every core that is not waiting on a worker and has something to run
+//gets its next slice dispatched to its worker thread. The job stays at the front of its
+//queue while the slice is in flight, so end_slice() works exactly as it does in
+//process_job(). Return whether any slice is in flight
+bool Scheduler::dispatch_slices() {
+	bool anyBusy = false;
+	
+	steal_for_idle_cores();
+	
+	for (unsigned i = 0; i < cores.size(); i++) {
+		if (!cores[i].busy && pick_from_core(&cores[i])) {
+			int begin  = cores[i].clock;
+			int length = run_slice();
+			WorkerPool::Slice s = {(int) i, current, priority, length,
+								   {begin, current->get_pid(), cores[i].clock - begin, 0,
+									Timeline::SLICE, (int16_t) priority, (int16_t) i}};
+			
+			cores[i].busy     = true;
+			cores[i].inFlight = current;
+			pool->dispatch(s);
+		}
+		anyBusy = anyBusy || cores[i].busy;
+	}
+	
+	return anyBusy;
+}
+
+//Parallel mode: drain the worker pool's completion queue and finish each slice on the
+//Scheduler thread. A slice whose job was killed while it was in flight is dropped
+void Scheduler::collect_slices() {
+	WorkerPool::Slice s;
+	
+	while (pool->collect(s)) {
+		Core *c = &cores[s.core];
+		c->busy = false;
+		
+		if (c->inFlight != s.job) {continue;}
+		
+		c->inFlight = NULL;
+		core     = c;
+		current  = s.job;
+		priority = s.priority;
+		end_slice(s.length);
+	}
+}
+
+//Take j out of whichever queue it is in -- waitingOnMem or any priority of any core --
+//in O(1), and give back its memory and its place on the core if it was running. Called
+//just before j is freed
+void Scheduler::unqueue(Job *j) {
+	JobQueue *q = j->get_queue();
+	
+	if (q != NULL && j->get_status() == Job::RUNNING) {
+		Core *c = core_of(q);
+		
+		remove_run(c, q - &c->runs[0], j);
+		c->load--;
+		use_memory(-j->get_resources());
+	} else if (q != NULL) {
+		waitingOnMem.remove(j);
+	}
+	drop_in_flight(j);
 }
 
-//Called when current has finished processing in it's allocated time slice. (Execute
-//similar tasks to above)
-void Scheduler::complete_processing() {
-	win.feed_bar("Job #%d: completed", current->get_pid()); //print to feed
-	memoryUsed -= current->get_resources(); //take resources off memory
-	runs[priority].pop(); //pop from the queue
-	totalComplete++; //increment the Job::COMPLETE counter (used for statistics)
-	current->set_clock_complete(runClock); //record runClock time (for statistics)
-	update_stats(); //update the statistics bar
-	update_successors();//remove dependents from all successors & run eligible successors
+//Return the core whose runs vector q belongs to
+Scheduler::Core *Scheduler::core_of(JobQueue *q) {
+	for (unsigned i = 0; i < cores.size(); i++) {
+		if (q >= &cores[i].runs[0] && q < &cores[i].runs[0] + NUM_QUEUES) {
+			return &cores[i];
+		}
+	}
+	throw logic_error("JobQueue does not belong to any core");
 }
 
-//Given that current and priority are already set, determine the time slice and run
-//the clock / sleep / decrement execTime by that slice. If the job finished, call
-//complete_processing(), otherwise, move it to the appropriate place in the MLFQ
-void Scheduler::process_job() {
+//Forget about j if a worker is processing it (j is about to be freed)
+void Scheduler::drop_in_flight(Job *j) {
+	for (unsigned i = 0; i < cores.size(); i++) {
+		if (cores[i].inFlight == j) {
+			cores[i].inFlight = NULL;
+		}
+	}
+}
+
+//Return the slice j gets when it runs at priority p.
+//Given the mode, we determine the slice based off the original quantum different.
+//First, if VARY_QUANTA, higher priorities have shorter quanta, and secondly, if
+//CHAIN_WEIGHTING, the slice is factored by the longest chain number of the job. In
+//CRITICAL_PATH mode that is the work on the longest chain behind j in units of j's own
+//burst, so a chain of equal jobs weighs the same as in Chain Weighting Mode, but a
+//chain of short jobs behind a long one hardly counts. It uses the burst j arrived with,
+//not what is left of it, so the slice stays the same while j runs (as fast_forward()
+//needs)
+int Scheduler::slice_for(Job *j, int p) {
 	int slice = BASE_QUANTUM;
-	//Given the mode, we determine the slice based off the original quantum different.
-	//First, if VARY_QUANTA, higher priorities have shorter quanta, and secondly, if
-	//CHAIN_WEIGHTING, the slice is factored by the longest chain number of the job
+	
 	if (VARY_QUANTA) {
-		slice -= (BASE_QUANTUM / runs.size()) * priority;
+		slice -= (BASE_QUANTUM / NUM_QUEUES) * p;
 	}
 	
-	if (CHAIN_WEIGHTING) {
-		slice *= current->get_longest_chain() + 1;
-	}
+	if (CRITICAL_PATH) {
+		int 	  burst    = max(arena.stats(j).originalExecTime, 1);
+		long long weighted = slice * (arena.chain(j).longestChain / burst + 1);
 		
-	//"run" current (i.e. decrement the job's remaining execTime) for a time slice that
-	//is as long as current's priority's time quantum will allow OR until complete
-	runClock += current->decrease_time(slice);
-	std::this_thread::sleep_for(std::chrono::microseconds(JIFFIE_TIME * slice));
-		
-	output_status(slice); //update the status bar
+		slice = (int) min(weighted, (long long) INT_MAX);
+	} else if (CHAIN_WEIGHTING) {
+		slice *= arena.chain(j).longestChain + 1;
+	}
+	
+	return slice;
+}
 
-	if (runs[priority].front()->get_status() == Job::COMPLETE) { //completed during slice
-		complete_processing();
-	} else { //job gets bumped down a priority unless already in round robin base
-		runs[priority].pop();
+//Discrete event shortcut for headless mode. Once every job has sunk to the round robin
+//base (priority 0), a full round of slices changes nothing except execTimes and the
+//clock: nobody gets demoted, memory is only released by a completion, and no job
+//arrives. So we can jump straight over every round that ends before the next
+//completion. For each job, rounds = ceil(execTime / slice) - 1 full slices are
+//left before the slice it completes in; the minimum of those is skipped in one step.
+//The queue order is unchanged after whole rounds, so the result is identical to
+//stepping slice by slice.
+//
+//Returns how many slices to process before calling again. Scanning the base queue is
+//O(k) for k jobs, so it is only worth doing once per round. With more than one core the
+//cores interleave and any round can be eventful, so this only applies to one core.
+//
+//Arrivals are the catch. A job file is loaded before the run starts, but run_headless()
+//also makes the jobs submit()ted from other threads while it runs, between slices.
+//Those have no arrival time on the virtual clock: each is inserted at whatever runClock
+//it is ingested at. So nothing is skipped while a submission is waiting, but one that
+//comes in during a jump is still inserted after it, as late as the jump was long. Jobs
+//that must arrive at a given virtual time go through run_headless_until(), which never
+//fast forwards.
+int Scheduler::fast_forward() {
+	if (priority != 0 || cores.size() > 1 || !submitted.empty()) {return 0;}
+	
+	vector<JobQueue> &runs = core->runs;
+	int  k = runs[0].size();
+	int  rounds = -1;
+	long roundTime = 0;
+	
+	//First pass: find the fewest whole rounds any job can survive. Rotating the queue
+	//k times leaves it in the same order
+	for (int i = 0; i < k; i++) {
+		Job *j = runs[0].front();
+		int  slice = slice_for(j, 0);
+		int  r = (j->get_exec_time() - 1) / slice;
 		
-		if (priority > 0) {
-			priority--;
-		}
-		runs[priority].push(current);
+		if (rounds == -1 || r < rounds) {rounds = r;}
+		roundTime += slice;
+		
+		runs[0].pop();
+		runs[0].push(j);
+	}
+	
+	if (boostInterval > 0 && (core->nextBoost - core->clock) / roundTime < rounds) {
+		rounds = (core->nextBoost - core->clock) / roundTime; //the boost comes on time
+	}
+	if (checkpointInterval > 0 && (nextCheckpoint - core->clock) / roundTime < rounds) {
+		rounds = (nextCheckpoint - core->clock) / roundTime; //...and so does a checkpoint
+	}
+	if (rounds <= 0) {return k;}
+	
+	//Second pass: run every job for that many rounds at once
+	for (int i = 0; i < k; i++) {
+		Job *j = runs[0].front();
+		j->decrease_time(rounds * slice_for(j, 0));
+		runs[0].pop();
+		runs[0].push(j);
 	}
+	
+	timeline.record(Timeline::FAST_FORWARD, core->clock, core - &cores[0], 0, k,
+					rounds * roundTime, rounds);
+	core->clock    += rounds * roundTime;
+	core->busyTime += rounds * roundTime;
+	runClock = core->clock;
+	slices  += (long long) rounds * k;
+	current = runs[0].front();
+	return k;
 }
 
 //Go through current's successors, remove current's PID from all of the successor's
 //dependency lists, then, if dependency list is empty, insert that successor into
 //the runs
 void Scheduler::update_successors() {
-	Job::JobList *successors = current->get_successors();
+	Job::JobList &successors = arena.graph(current).successors;
 
-	for (unsigned i = 0; i < successors->size(); i++) {
-		successors->at(i)->remove_dependency(current->get_pid());
+	for (unsigned i = 0; i < successors.size(); i++) {
+		JobGraph &g = arena.graph(successors[i]);
 		
-		if (successors->at(i)->no_dependencies()) {
-			waitingOnMem.push(successors->at(i));
+		g.remove_dependency(current->get_id());
+		
+		if (g.dependencies.empty()) {
+			timeline.record(Timeline::RELEASE, runClock, 0, 0,
+							arena.job(successors[i])->get_pid(), current->get_pid(), 0);
+			waitingOnMem.push(arena.job(successors[i]));
 		}
 	}
+	arena.release_successors(current); //nothing looks at a completed job's successors
 }
 
 //Longest chain algorithm. A job's longest chain is the net jobs that must be completed
-//to finish the longest possible chain of successors. This method starts with a new
-//job j that was added, and recalculates the times of all jobs that are in j's chain of
-//dependencies -- note j is NOT the job for which we want to recalculate the longest chain
-//variable. Note also that we are computing # of jobs, not net burst time; see ReadMe
-//for why this makes more sense
+//to finish the longest possible chain of successors, i.e. 1 + the longest chain of its
+//longest successor. This method is called when job j just gained a successor whose
+//chain makes num a candidate for j's longest chain, and updates j and every job in j's
+//chain of dependencies whose longest chain grows as a result. Note also that we are
+//computing # of jobs, not net burst time; see ReadMe for why this makes more sense. In
+//CRITICAL_PATH mode it is net burst time after all: each successor adds its burst
+//instead of 1 (see chain_weight). A successor cannot run before j completes, so its
+//burst does not change while it counts here
+//
+//This used to recurse down every dependency path, which is exponential in the depth of
+//a DAG with diamonds. Now it is done in two passes, neither of which recurses (so a
+//deep chain cannot blow the stack) and each of which visits a job at most once:
 //
-//No help from online resources; it really is not very complex.
-//I loosely based my mindset on Dijkstra. Not sure if this is the optimal complexity
-//or not but I'd rather use recursion than determine whether another solution is more
-//optimized without relying on the runtime stack.
-void Scheduler::deep_search_update(Job *j, int num) {
-	//Recurse through all of j's dependents with an incremented num (base case if no
-	//dependents exist)
-	for (unsigned i = 0; i < j->get_dependencies()->size(); i++) {
-		deep_search_update(j->get_dependencies()->at(i), num + 1);
+//1. Collect. If j grows by delta, no dependency anywhere up the chain can grow by more
+//   than delta, so a dependency d of a job k is only worth visiting if
+//   k's chain + delta + k's weight > d's chain. Every job reached like this is stamped
+//   with chainStamp, and chainPending counts its successors that were collected too.
+//2. Propagate. Kahn's algorithm over the collected jobs, starting at j: a job is
+//   finished once all its collected successors are, so by then chainBest holds the best
+//   chain any of them offers it. Jobs that do not grow still release their dependencies
+//   but offer them nothing.
+//
+//The test in 1 is repeated in 2 with the same (old) chains, so the pending counts match
+//exactly. A dependency cycle (which is not a DAG, but nothing stops a client from
+//entering one) cannot loop forever: a job is only ever queued when its count reaches 0.
+void Scheduler::deep_search_update(Job *j, long long num) {
+	JobChain &jc = arena.chain(j);
+	long long delta = num - jc.longestChain;
+	
+	if (delta <= 0) {return;} //the common case: j's chain does not change
+	
+	chainStamp++;
+	chainStack.clear();
+	
+	jc.chainMark    = chainStamp;
+	jc.chainPending = 0;
+	jc.chainBest    = num;
+	chainStack.push_back(j->get_id());
+	
+	//1. Collect (depth first, with chainStack as the stack)
+	while (!chainStack.empty()) {
+		uint32_t  k  = chainStack.back();
+		JobChain &kc = arena.chain(k);
+		long long weight = chain_weight(k);
+		chainStack.pop_back();
+		
+		JobList &deps = arena.graph(k).dependencies;
+		for (unsigned i = 0; i < deps.size(); i++) {
+			JobChain &dc = arena.chain(deps[i]);
+			
+			if (kc.longestChain + delta + weight <= dc.longestChain) {continue;}
+			
+			if (dc.chainMark != chainStamp) {
+				dc.chainMark    = chainStamp;
+				dc.chainPending = 0;
+				dc.chainBest    = 0;
+				chainStack.push_back(deps[i]);
+			}
+			dc.chainPending++;
+		}
 	}
 	
-	//If the passed num is greater than j's current longest chain, then set the
-	//new longest. (NB: Job's constructor always initiates longest chain to 0)
-	if (num > j->get_longest_chain()) {
-		j->set_longest_chain(num);
+	//2. Propagate (in topological order, with chainStack as the queue of finished jobs)
+	chainStack.push_back(j->get_id());
+	
+	while (!chainStack.empty()) {
+		uint32_t  k  = chainStack.back();
+		JobChain &kc = arena.chain(k);
+		long long weight = chain_weight(k);
+		chainStack.pop_back();
+		
+		long long old   = kc.longestChain;
+		bool 	  grows = kc.chainBest > old;
+		
+		if (grows) {kc.longestChain = kc.chainBest;}
+		
+		JobList &deps = arena.graph(k).dependencies;
+		for (unsigned i = 0; i < deps.size(); i++) {
+			JobChain &dc = arena.chain(deps[i]);
+			
+			if (old + delta + weight <= dc.longestChain) {continue;}
+			
+			if (grows && kc.longestChain + weight > dc.chainBest) {
+				dc.chainBest = kc.longestChain + weight;
+			}
+			if (--dc.chainPending == 0) {
+				chainStack.push_back(deps[i]);
+			}
+		}
+	}
+}
+
+//What successor k adds to the chain of each job it depends on: 1 job, or in
+//CRITICAL_PATH mode its burst (from its JobStats, so the Job itself is still not read)
+long long Scheduler::chain_weight(uint32_t k) {
+	return CRITICAL_PATH ? arena.stats(k).originalExecTime : 1;
+}
+
+//The other direction: the jobs on chainStack just lost successors (see detach() and
+//cancel_subgraph()). Each recomputes its longest chain from the successors it has left,
+//and if it shrank, the jobs it depends on whose chain ran through it do the same in
+//turn. With chainStack as the worklist; a job in a diamond may be visited once per
+//path, but a chain only ever shrinks so this ends
+void Scheduler::shrink_chains() {
+	while (!chainStack.empty()) {
+		uint32_t  k    = chainStack.back();
+		JobChain &kc   = arena.chain(k);
+		long long was  = kc.longestChain + chain_weight(k);
+		long long best = 0;
+		chainStack.pop_back();
+		
+		JobList &succ = arena.graph(k).successors;
+		for (unsigned i = 0; i < succ.size(); i++) {
+			best = max(best, arena.chain(succ[i]).longestChain + chain_weight(succ[i]));
+		}
+		if (best >= kc.longestChain) {continue;}
+		kc.longestChain = best;
+		
+		JobList &deps = arena.graph(k).dependencies;
+		for (unsigned i = 0; i < deps.size(); i++) {
+			if (arena.chain(deps[i]).longestChain == was) {chainStack.push_back(deps[i]);}
+		}
 	}
 }
 
@@ -283,6 +1396,15 @@ void Scheduler::main_menu_input(char input) {
 		case 'f':
 			add_from_file();
 			break;
+		case 's':
+			checkpoint_from_input();
+			break;
+		case 'h':
+			histograms_from_input();
+			break;
+		case 't':
+			timeline_from_input();
+			break;
 		default:
 			win.clear_console();
 			win.console_bar("Must input from list of characters above.");
@@ -296,38 +1418,135 @@ void Scheduler::main_menu_input(char input) {
 
 //Handles a request to add a list of jobs from an external file source.
 void Scheduler::add_from_file() {
-	ifstream inFile;
-	char     fileName[256]; //Just using a C style string to begin with for simplicity
-	bool     fail = false;
+	TraceReader trace;
+	char fileName[256]; //Just using a C style string to begin with for simplicity
 	
 	win.clear_console();
 
 	while (true) {
 		win.menu_bar("Enter a file name: ");
 		getstr(fileName); //Of NCurses API; dont need CursesHandler because already C str
-		inFile.open(fileName);
 		
-		if (inFile.fail()) {
+		if (!trace.open(fileName)) {
 			win.console_bar("File not found.");
 		} else {
 			break;
 		}
 	}
 	
-	win.console_bar("Loading a large file may take a while if Chain Weighting Mode is"
-					" enabled....");
-	while (!inFile.eof()) {
-		if (!make_job_from_line(inFile)) {
-			fail = true;
-		}	
-	}
-	inFile.close();
+	win.console_bar("Loading....");
+	int loaded = load_jobs(trace);
+	vector<TraceReader::Error> &errors = trace.get_errors();
 	
-	if (fail) {win.console_bar("Loaded with some errors (see feed): ", fileName);}
-	else 	  {win.console_bar("Successfully loaded: ", fileName);}
+	win.clear_console();
+	win.console_bar(0, "Loaded %d jobs from:", loaded);
+	win.console_bar(1, "%s", fileName);
+	win.console_bar(2, "Errors: %d", errors.size());
+	for (unsigned i = 0; i < errors.size() && i < 3; i++) {
+		win.console_bar(3 + i, (trace.is_binary() ? "Record %d: " : "Line %d: ") +
+						errors[i].message, errors[i].line);
+	}
+	win.feed_bar("Loaded %d jobs from file", loaded);
 	refresh();
 }
 
+//Handles a request to checkpoint from the menu: to the --checkpoint file if there is
+//one, else to a file the user names
+void Scheduler::checkpoint_from_input() {
+	char fileName[256];
+	
+	win.clear_console();
+	
+	if (checkpointPath.empty()) {
+		win.menu_bar("Enter a file name for the checkpoint: ");
+		getstr(fileName);
+	} else {
+		snprintf(fileName, sizeof(fileName), "%s", checkpointPath.c_str());
+	}
+	
+	if (checkpoint(fileName)) {
+		win.console_bar(0, "Writing the checkpoint of jiffy %d to:", runClock);
+		win.console_bar(1, "%s", fileName);
+	} else if (checkpointChild != -1) {
+		win.console_bar("The last checkpoint is still being written.");
+	} else {
+		win.console_bar("Cannot start a checkpoint.");
+	}
+}
+
+//Handles a request to export the histograms from the menu: to the --histograms file if
+//there is one, else to a file the user names
+void Scheduler::histograms_from_input() {
+	char fileName[256];
+	
+	win.clear_console();
+	
+	if (histogramPath.empty()) {
+		win.menu_bar("Enter a file name for the histograms: ");
+		getstr(fileName);
+	} else {
+		snprintf(fileName, sizeof(fileName), "%s", histogramPath.c_str());
+	}
+	
+	const char *error = export_histograms(fileName);
+	
+	if (error == NULL) {
+		win.console_bar(0, "Histograms of %d jobs written to:", totalComplete);
+		win.console_bar(1, "%s", fileName);
+	} else {
+		win.console_bar(error);
+	}
+}
+
+//Handles t in the menu: start tracing, or stop and export the timeline to the
+//--timeline file if there is one, else to a file the user names
+void Scheduler::timeline_from_input() {
+	char fileName[256];
+	
+	win.clear_console();
+	
+	if (!timeline.is_enabled()) {
+		trace_events(true);
+		win.console_bar("Tracing. Press t again to stop and write the timeline.");
+		return;
+	}
+	
+	trace_events(false);
+	if (timelinePath.empty()) {
+		win.menu_bar("Enter a file name for the timeline: ");
+		getstr(fileName);
+	} else {
+		snprintf(fileName, sizeof(fileName), "%s", timelinePath.c_str());
+	}
+	
+	const char *error = export_timeline(fileName);
+	
+	if (error == NULL) {
+		win.console_bar(0, "Timeline of %d events written to:",
+						(int) timeline.get_kept());
+		win.console_bar(1, "%s", fileName);
+	} else {
+		win.console_bar(error);
+	}
+}
+
+//Make a job from every record in trace and return how many were made. Every bad record
+//is reported to the trace (with its line) rather than to the UI, so a big file is not
+//slowed down by a screen update per line; the caller shows the summary
+int Scheduler::load_jobs(TraceReader &trace) {
+	TraceReader::Record r;
+	int loaded = 0;
+	
+	while (trace.next(r)) {
+		const char *error = make_job_from_record(r);
+		
+		if (error == NULL) {loaded++;}
+		else 			   {trace.report(r.line, error);}
+	}
+	
+	return loaded;
+}
+
 //Add a job from cin. Record execTime, resources, and then call read_dependencies()
 //to generate a pointer to a IntBST that includes every PID of each dependency
 //that the user specifies via cin. Insert the job into the JobHashTable "jobs". Then,
@@ -343,123 +1562,114 @@ void Scheduler::make_job_from_cin() {
 	//We now prepare the job with the given information. This will automatically set the 
 	//job status from LATENT to WAITING
 	j->prepare(cin_exec_time(), cin_resources());
+	arena.stats(j).originalExecTime = j->get_exec_time();
 	
 	//Now we read all dependencies and add them
-	read_dependencies(j, false, cin);
+	read_dependencies(j);
 	
 	//If j has no dependencies, we push it immediately to waitingOnMem, where it waits
 	//to be pushed into the runs
-	if (j->no_dependencies()) {
+	if (arena.graph(j).dependencies.empty()) {
 		waitingOnMem.push(j);
 	} //else, we don't do anything. j will sit in "jobs" until its dependencies
 	//list is empty, in which case process_job() will take care of pushing to waitingOnMem
 	
-	j->set_clock_insert(runClock);
+	arena.stats(j).clockInsert      = runClock;
+	
+	if (journal != NULL) {
+		TraceReader::Record r;
+		
+		r.pid 		= j->get_pid();
+		r.execTime  = j->get_exec_time();
+		r.resources = j->get_resources();
+		r.deps 		= pids_of(arena.graph(j).dependencies);
+		journal->append_insert(runClock, r);
+	}
 	
 	win.clear_console();
 	win.console_bar(0, "Created new job: #%d", j->get_pid());
 	win.console_bar(1, "Execution time: %d", j->get_exec_time());
 	win.console_bar(2, "Resources required: %d", j->get_resources());
 	win.console_bar(3, "Dependents:");
-	win.console_bar(4, j->get_dependencies());
+	win.console_bar(4, pids_of(arena.graph(j).dependencies));
 }
 
-//Same as make_job_from_cin but everything is processed from an istream instead of user
-//input. See above for more details and comments explaining code segments
-bool Scheduler::make_job_from_line(istream &inFile) {
-	int  pid;
-	int  execTime;
-	int  resources;
-	
-	inFile >> pid;
-	inFile >> execTime;
-	inFile >> resources;
+//Same as make_job_from_cin but everything comes from a record of a trace file. See
+//above for more details and comments explaining code segments. Return why the record
+//was rejected, or NULL if the job was made
+const char *Scheduler::make_job_from_record(TraceReader::Record &r) {
+	Job *j = jobs.find(r.pid);
 	
-	Job *j = jobs.find(pid);
-	win.clear_console();
-		if (execTime <= 0) {
-		return file_error("Eecution time must be positive", pid, inFile);
-	} else if (resources > MAX_MEMORY) {
-		return file_error("Cannot use more than MAX MEMORY.", pid, inFile);
-	} else if (resources < 0) {
-		return file_error("Resources cannot be negative.", pid, inFile);	
+	if (r.execTime <= 0) {
+		return "Execution time must be positive";
+	} else if (r.resources > MAX_MEMORY) {
+		return "Cannot use more than MAX MEMORY";
+	} else if (r.resources < 0) {
+		return "Resources cannot be negative";
 	} else if (j != NULL && j->get_status() != Job::LATENT) {
-		return file_error("job already exists", pid, inFile);
+		return "Job already exists";
+	} else if (j == NULL && completed.contains(r.pid)) {
+		return "Job already completed";
 	} else if (j == NULL) {
-		j = new Job(pid);
+		j = arena.make(r.pid);
 		jobs.insert(j);
 	} 
 	
-	j->prepare(execTime, resources); //(see details above)
-	read_dependencies(j, true, inFile);
+	j->prepare(r.execTime, r.resources); //(see details above)
+	arena.stats(j).originalExecTime = r.execTime; //before its weight counts in a chain
+	for (unsigned i = 0; i < r.deps.size(); i++) {
+		add_dependency(j, r.deps[i]);
+	}
 
-	if (j->no_dependencies())
+	if (arena.graph(j).dependencies.empty())
 		waitingOnMem.push(j);
 	
-	j->set_clock_insert(runClock);
-	win.feed_bar("Created new job PID #%d", pid);
-	return true;
+	arena.stats(j).clockInsert      = runClock;
+	
+	if (journal != NULL) {journal->append_insert(runClock, r);}
+	return NULL;
 }
 
-
-//Take a list of PIDs from cin. For each PID, check the "jobs" JHT to see
-//whether it is already Job::COMPLETE. If it isn't already Job::COMPLETE, add it to a
-//JHT called dependencies. Also, append the job pointer j to that PID's successor
-//list. When finished, return the dependencies JHT. (NOTE: there are two different
-//uses of the JHT class here)
-void Scheduler::read_dependencies(Job *j, bool externalFile, istream &inFile) {
-	int  pid = -2;
-	Job *dependentJob;
-	
-	if (!externalFile) {
-		win.menu_bar("Enter dependencies, enter -1 when finished: ");
-	}
+//Take a list of PIDs from cin and add each one as a dependency of j, until the -1
+//sentinel
+void Scheduler::read_dependencies(Job *j) {
+	win.menu_bar("Enter dependencies, enter -1 when finished: ");
 	
 	for (int i = 1; true; i++) { //runs for true because sentinel breaks loop
-		pid = get_dependent_pid(externalFile, i, inFile);
+		int pid = win.get_int_input();
+		win.keep_cursor_in_menu(i);
 		
 		if (pid == -1) {break;} //just using a simple -1 sentinel
-	
-		dependentJob = jobs.find(pid);
-		
-		//If the job specified does not already exist in jobs, we create a new latent job
-		if (dependentJob == NULL) {
-				dependentJob = new Job(pid);
-				jobs.insert(dependentJob);
-		}
-		//If the dependentJob is already complete, we just ignore that input entirely
-		if (dependentJob->get_status() != Job::COMPLETE) {
-			j->add_dependency(dependentJob); //insert job into the dependencies table
-			dependentJob->add_successor(j); //and add to give job's successors
-			//Now we run the deep search function on the new dependent job.
-			//Note that we pass the second parameter as 1 + j's current longest chain,
-			//which might not necessarily be 0 if it was initialized out of a latent state
-			if (CHAIN_WEIGHTING) {
-				deep_search_update(dependentJob, j->get_longest_chain() + 1);
-			}
-		}
+		
+		add_dependency(j, pid);
 	}
 }
 
-//get pid either from cin or from istream
-int Scheduler::get_dependent_pid(bool externalFile, int i, istream &inFile) {
-	int pid;
-	
-	if (externalFile) { 
-		inFile >> pid;
-	} else {
-		pid = win.get_int_input();
-		win.keep_cursor_in_menu(i);
-	}
+//Check whether the job with this PID is already Job::COMPLETE. If it isn't, add it to
+//j's dependencies and append j to that job's successor list
+void Scheduler::add_dependency(Job *j, int pid) {
+	Job *dependentJob = jobs.find(pid);
 	
-	return pid;
-}
+	//A job that completed is only remembered in completed; the dependency is satisfied
+	if (dependentJob == NULL && completed.contains(pid)) {return;}
 	
-
-bool Scheduler::file_error(string str, int pid, istream &inFile) {
-	win.feed_bar("Error reading file: PID #%d: " + str, pid);
-	inFile.ignore(256, '\n');
-	return false;
+	//If the job specified does not already exist in jobs, we create a new latent job
+	if (dependentJob == NULL) {
+			dependentJob = arena.make(pid);
+			jobs.insert(dependentJob);
+	}
+	//If the dependentJob is already complete, we just ignore that input entirely
+	if (dependentJob->get_status() != Job::COMPLETE) {
+		arena.link(dependentJob, j); //j depends on dependentJob, and is its successor
+		//Now we run the deep search function on the new dependent job.
+		//Note that we pass the second parameter as j's weight (1, or its burst) + j's
+		//current longest chain, which might not necessarily be 0 if it was initialized
+		//out of a latent state
+		if (CHAIN_WEIGHTING) {
+			deep_search_update(dependentJob,
+							   arena.chain(j).longestChain + chain_weight(j->get_id()));
+		}
+	}
 }
 
 int Scheduler::cin_pid() {
@@ -472,12 +1682,12 @@ int Scheduler::cin_pid() {
 
 		j = jobs.find(pid);
 		
-		if (j != NULL && j->get_status() != Job::LATENT) {
+		if ((j != NULL && j->get_status() != Job::LATENT) || completed.contains(pid)) {
 			win.console_bar("PID #%d already exists. Enter a different PID.", pid);
 		} else {
 			if (j == NULL) {
 				//Create a new Job and insert it into the hashtable
-				j = new Job(pid);
+				j = arena.make(pid);
 				jobs.insert(j);
 				win.console_bar("Creating new job PID #%d", pid);
 			} //else, it already exists as latent
@@ -531,7 +1741,10 @@ void Scheduler::lookup_from_input() {
 
 	win.clear_console();
 	
-	if (jobs.find(pid) == NULL) {
+	if (jobs.find(pid) == NULL && completed.contains(pid)) {
+		win.console_bar("Job #%d:", pid);
+		win.console_bar(1, "Job::COMPLETE");
+	} else if (jobs.find(pid) == NULL) {
 		win.console_bar("Error: this PID does not exist anywhere");
 	} else {
 		job_on_console(jobs.find(pid));
@@ -550,22 +1763,25 @@ void Scheduler::job_on_console(Job *j) {
 			win.console_bar(2, "Burst time remaining: %d", j->get_exec_time());
 			win.console_bar(3, "Resources allocated: %d", j->get_resources());
 			win.console_bar(4, "Successors: ");
-			win.console_bar(5, j->get_successors());
-			win.console_bar(6, "Longest chain: %d", j->get_longest_chain());
+			win.console_bar(5, pids_of(arena.graph(j).successors));
+			win.console_bar(6, CRITICAL_PATH ? "Critical path: %d" : "Longest chain: %d",
+						   longest_chain(j));
 			break;
 		case Job::WAITING:
 			win.console_bar(1, "Job::WAITING");
 			win.console_bar(2, "Dependents:");
-			win.console_bar(3, j->get_dependencies());
+			win.console_bar(3, pids_of(arena.graph(j).dependencies));
 			win.console_bar(4, "Successors:");
-			win.console_bar(5, j->get_successors());
-			win.console_bar(6, "Longest chain: %d", j->get_longest_chain());
+			win.console_bar(5, pids_of(arena.graph(j).successors));
+			win.console_bar(6, CRITICAL_PATH ? "Critical path: %d" : "Longest chain: %d",
+						   longest_chain(j));
 			break;
 		case Job::LATENT:
 			win.console_bar(1, "Job::LATENT");
 			win.console_bar(2, "Successors:");
-			win.console_bar(3, j->get_successors());
-			win.console_bar(4, "Longest chain: %d", j->get_longest_chain());
+			win.console_bar(3, pids_of(arena.graph(j).successors));
+			win.console_bar(4, CRITICAL_PATH ? "Critical path: %d" : "Longest chain: %d",
+						   longest_chain(j));
 			break;
 	}
 }
@@ -583,25 +1799,22 @@ void Scheduler::kill_job() {
 	pid = win.get_int_input();
 	j = jobs.find(pid);
 	
-	if (j == NULL) {
+	if (j == NULL && completed.contains(pid)) {
+		win.console_bar("Error: this job is already completed");
+	} else if (j == NULL) {
 		win.console_bar("Error: this PID does not exist anywhere");
-	} else if (j->get_status() == Job::LATENT) {
-		win.console_bar("Error: this job cannot be killed at this time");
 	} else if (j->get_status() == Job::COMPLETE) {
 		win.console_bar("Error: this job is already completed");
-	} else if (!j->no_successors()) {
-		win.console_bar("Warning: some jobs are dependent on the completion of this job");
-		kill_check_continue(j);
+	} else if (!arena.graph(j).successors.empty()) {
+		win.console_bar("Warning: every job that depends on this job is cancelled too");
+		cancel_check_continue(j);
+	} else if (j->get_status() == Job::LATENT) {
+		win.console_bar("Error: this job cannot be killed at this time");
 	} else if (j->get_status() == Job::WAITING) {
 		win.console_bar("Warning: this job has not yet began processing");
 		kill_check_continue(j);
 	} else {
-		jobs.remove(pid); //remove j from the jobs hashtable
-		delete j; //permanently free j from the heap
-		//find j in the runs and remove it so the dead pointer wont get dereferenced
-		for (unsigned i = 0; i < runs.size(); i++) {
-			if (runs[i].force_pop(pid)) {break;}
-		}
+		kill(j);
 		win.console_bar("Job #%d killed prematurely.", pid);
 	}
 }
@@ -610,39 +1823,198 @@ void Scheduler::kill_check_continue(Job *j) {
 	win.menu_bar("Remove anyway? y/n");
 	
 	if (win.get_y_n()) {
-		convert_to_latent(j);		
-		win.console_bar("Job #%d killed prematurely.", j->get_pid());
+		int pid = j->get_pid();
+		kill(j);
+		win.console_bar("Job #%d killed prematurely.", pid);
+	}
+}
+
+//For a job with successors (even a latent one): kill it and everything downstream
+void Scheduler::cancel_check_continue(Job *j) {
+	win.menu_bar("Cancel them all? y/n");
+	
+	if (win.get_y_n()) {
+		int pid 	  = j->get_pid();
+		int cancelled = cancel_subgraph(j);
+		
+		win.console_bar(0, "Job #%d killed prematurely,", pid);
+		win.console_bar(1, "and %d jobs that depended on it cancelled.", cancelled - 1);
+		win.feed_bar("Job #%d: cancelled with everything downstream", pid);
+	}
+}
+
+//A running job nothing depends on is forgotten altogether; any other job goes back to
+//being latent so its successors keep waiting on its PID
+void Scheduler::kill(Job *j) {
+	if (journal != NULL) {journal->append_kill(runClock, j->get_pid());}
+	
+	if (j->get_status() == Job::RUNNING && arena.graph(j).successors.empty()) {
+		jobs.remove(j->get_pid()); //remove j from the jobs hashtable
+		//remove j from its queue so the dead pointer wont get dereferenced
+		unqueue(j);
+		arena.release(j); //its slot goes to the next job made
+	} else {
+		convert_to_latent(j);
+	}
+}
+
+int Scheduler::cancel(int pid) {
+	Job *j = jobs.find(pid);
+	
+	return j == NULL ? 0 : cancel_subgraph(j);
+}
+
+//Cascading kill: j and every job downstream of it, however deep, in time linear in the
+//subgraph's jobs and edges (plus the successor lists of the jobs outside it that it
+//depended on), without recursion. Return how many jobs were cancelled
+//
+//1. Collect. Breadth first from j along successor lists, with cancelled as the queue.
+//   A job is marked CANCELLED as it goes in, so one reached along several paths goes in
+//   once.
+//2. Cut loose. Each job outside the subgraph that one inside depends on drops all of
+//   them from its successor list in a single pass (and is marked DEPENDED_ON, so a job
+//   that the whole subgraph depends on is still only passed over once). In Chain
+//   Weighting Mode their longest chains shrink to what is left.
+//3. Free. Each job is taken out of its queue (giving back its memory if it was running,
+//   which only j can be: the rest still wait on a dependency) and forgotten. So is a
+//   latent job outside that only the subgraph was waiting on: it was just a PID named
+//   as a dependency, and with no successors left nothing will ever look it up (it is
+//   not counted as cancelled)
+int Scheduler::cancel_subgraph(Job *j) {
+	if (journal != NULL) {journal->append_cancel(runClock, j->get_pid());}
+	
+	cancelled.clear();
+	cancelDeps.clear();
+	cancelled.push_back(j->get_id());
+	cancel_mark(j->get_id()) = CANCELLED;
+	
+	//1. Collect
+	for (size_t i = 0; i < cancelled.size(); i++) {
+		JobList &succ = arena.graph(cancelled[i]).successors;
+		
+		for (unsigned s = 0; s < succ.size(); s++) {
+			if (cancel_mark(succ[s]) == UNMARKED) {
+				cancel_mark(succ[s]) = CANCELLED;
+				cancelled.push_back(succ[s]);
+			}
+		}
+	}
+	
+	//2. Cut loose
+	for (size_t i = 0; i < cancelled.size(); i++) {
+		JobList &deps = arena.graph(cancelled[i]).dependencies;
+		
+		for (unsigned d = 0; d < deps.size(); d++) {
+			if (cancel_mark(deps[d]) == UNMARKED) {
+				cancel_mark(deps[d]) = DEPENDED_ON;
+				cancelDeps.push_back(deps[d]);
+				arena.graph(deps[d]).remove_marked_successors(cancelMarks, CANCELLED);
+			}
+		}
+	}
+	if (CHAIN_WEIGHTING) {
+		chainStack.assign(cancelDeps.begin(), cancelDeps.end());
+		shrink_chains();
+	}
+	
+	//3. Free
+	for (size_t i = 0; i < cancelled.size(); i++) {
+		Job *k = arena.job(cancelled[i]);
+		
+		cancelMarks[cancelled[i]] = UNMARKED;
+		unqueue(k);
+		jobs.remove(k->get_pid());
+		arena.release(k);
+	}
+	for (size_t i = 0; i < cancelDeps.size(); i++) {
+		Job *d = arena.job(cancelDeps[i]);
+		
+		cancelMarks[cancelDeps[i]] = UNMARKED;
+		if (d->get_status() == Job::LATENT && arena.graph(d).successors.empty()) {
+			jobs.remove(d->get_pid());
+			arena.release(d);
+		}
 	}
+	
+	timeline.record(Timeline::MEMORY, runClock, 0, 0, 0, memoryUsed, waitingOnMem.size());
+	return cancelled.size();
+}
+
+//id's CancelMark, growing cancelMarks to cover it (job ids are dense, so it only ever
+//grows to the most jobs there have been at once)
+uint8_t &Scheduler::cancel_mark(uint32_t id) {
+	if (id >= cancelMarks.size()) {cancelMarks.resize(id + 1, UNMARKED);}
+	return cancelMarks[id];
 }
 
-//we need to copy the successors, delete j, create a new Job::LATENT job, then update
-//the new Job::LATENT job with the successors
+//Take j out of wherever it is and reset it in place to a Job::LATENT job that keeps its
+//successors, so they keep waiting on its PID (and every pointer to j stays good)
 void Scheduler::convert_to_latent(Job *j) {
-	Job::JobList temp;
-	int pid = j->get_pid();
+	unqueue(j);
+	detach(j);
+	arena.reset(j);
+}
+
+//j's longest chain, which is only kept in Chain Weighting Mode (for the console, so it
+//is kept within an int)
+int Scheduler::longest_chain(Job *j) {
+	if (!CHAIN_WEIGHTING) {return 0;}
+	return (int) min(arena.chain(j).longestChain, (long long) INT_MAX);
+}
+
+//The PIDs of the jobs on list, for the console
+vector<int> Scheduler::pids_of(JobList &list) {
+	vector<int> pids(list.size());
 	
-	temp = *(j->get_successors());
-	jobs.remove(pid);
-	delete j;
-	j = new Job(pid);
-	jobs.insert(j);
+	for (unsigned i = 0; i < list.size(); i++) {
+		pids[i] = arena.job(list[i])->get_pid();
+	}
+	return pids;
+}
+
+//Remove j from the successor lists of the jobs it depends on (and in Chain Weighting
+//Mode take back what it added to their longest chains)
+void Scheduler::detach(Job *j) {
+	JobList &deps = arena.graph(j).dependencies;
+	
+	for (unsigned i = 0; i < deps.size(); i++) {
+		arena.graph(deps[i]).remove_successor(j->get_id());
+	}
+	if (!CHAIN_WEIGHTING) {return;}
+	
+	//Only the jobs whose longest chain may have run through j
+	long long offered = arena.chain(j).longestChain + chain_weight(j->get_id());
 	
-	for (unsigned i = 0; i < temp.size(); i++) {
-		j->add_successor(temp.at(i));
-	}			
+	chainStack.clear();
+	for (unsigned i = 0; i < deps.size(); i++) {
+		if (arena.chain(deps[i]).longestChain == offered) {chainStack.push_back(deps[i]);}
+	}
+	shrink_chains();
 }
 
 //Other output printers///////////////////////////////////////////////////////////////////
 
-void Scheduler::update_stats() {
-	//add current's runClock times into totals
-	totalLatency += current->get_latency();
-	totalTurnaround += current->get_turnaround();
-	totalResponse += current->get_response();
-	totalTurnPerBurst += totalTurnaround / current->get_original_exec();
-	totalLatencyPerBurst += totalLatency / current->get_original_exec();
+//Add current (completed at level) into the totals and histograms. The ratios are of
+//current's own times, not the running totals
+void Scheduler::update_stats(int level) {
+	JobStats &s = arena.stats(current);
+	int latency    = s.get_latency();
+	int turnaround = s.get_turnaround();
+	int response   = s.get_response();
+	int burst 	   = s.originalExecTime > 0 ? s.originalExecTime : 1;
+	
+	totalLatency += latency;
+	totalTurnaround += turnaround;
+	totalResponse += response;
+	totalTurnPerBurst += (double) turnaround / burst;
+	totalLatencyPerBurst += (double) latency / burst;
+	
+	allJobs			  .record(latency, response, turnaround, burst);
+	byLevel[level]	  .record(latency, response, turnaround, burst);
+	bySize[size_class(burst)].record(latency, response, turnaround, burst);
 	
 	//print all the statistics to 3 decimal places
+	win.begin_batch();
 	win.stats_bar(0, "Throughput: %g",        	  (double) totalComplete / runClock);
 	win.stats_bar(1, "Average latency: %g",       (double) totalLatency  / totalComplete);
 	win.stats_bar(2, "Average response time: %g", (double) totalResponse / totalComplete);
@@ -650,9 +2022,178 @@ void Scheduler::update_stats() {
 												(double) totalTurnaround / totalComplete);
 	win.stats_bar(4, "Average turnaround per burst time: %g",
 													   totalTurnPerBurst / totalComplete);
-	win.stats_bar(5, "Average latency per burst timet: %g",
+	win.stats_bar(5, "Average latency per burst time: %g",
 												    totalLatencyPerBurst / totalComplete);
 	win.stats_bar(6, "Total jiffies processed: %g", runClock);
+	win.end_batch();
+}
+
+//Print the same numbers as update_stats() to an ostream once a headless run is over,
+//followed by a line per core. jiffies_processed is the elapsed virtual time (the clock
+//of the core that finished last) and a core's utilization is its share of that time
+//spent processing. slices_processed counts scheduling decisions, including the slices
+//fast_forward() skipped over. Ratios with nothing to divide by are printed as 0 so the
+//JSON stays valid. The percentiles are read from the histograms over all jobs, so they
+//are within 1/64 of the exact ones
+void Scheduler::print_stats(ostream &out, bool json) {
+	use_memory(0); //bring memoryJiffies up to runClock
+	
+	double n = totalComplete == 0 ? 1 : totalComplete;
+	double memUtil = runClock == 0 ? 0 : (double) memoryJiffies / runClock / MAX_MEMORY;
+	double stats[] = {runClock == 0 ? 0 : (double) totalComplete / runClock,
+					  totalLatency / n,
+					  totalResponse / n,
+					  totalTurnaround / n,
+					  totalTurnPerBurst / n,
+					  totalLatencyPerBurst / n};
+	const char *names[] = {"throughput", "avg_latency", "avg_response", "avg_turnaround",
+						   "avg_turnaround_per_burst", "avg_latency_per_burst"};
+	const double points[] 	  = {50, 90, 99, 99.9};
+	const char  *pointNames[] = {"p50", "p90", "p99", "p99.9"};
+	double percentiles[CompletionHistograms::NUM_METRICS][4];
+	
+	for (int m = 0; m < CompletionHistograms::NUM_METRICS; m++) {
+		double unit = m == CompletionHistograms::SLOWDOWN ?
+					  CompletionHistograms::SLOWDOWN_UNIT : 1;
+		
+		for (int p = 0; p < 4; p++) {
+			percentiles[m][p] = allJobs.metric[m].percentile(points[p]) / unit;
+		}
+	}
+	
+	if (json) {
+		out << "{\n";
+		for (unsigned i = 0; i < 6; i++) {
+			out << "  \"" << names[i] << "\": " << stats[i] << ",\n";
+		}
+		out << "  \"jobs_completed\": " << totalComplete << ",\n"
+			<< "  \"jiffies_processed\": " << runClock << ",\n"
+			<< "  \"avg_memory_utilization\": " << memUtil << ",\n"
+			<< "  \"peak_memory\": " << memoryPeak << ",\n"
+			<< "  \"slices_processed\": " << slices << ",\n";
+		for (int m = 0; m < CompletionHistograms::NUM_METRICS; m++) {
+			out << "  \"" << CompletionHistograms::name_of(m) << "_percentiles\": {";
+			for (int p = 0; p < 4; p++) {
+				out << (p == 0 ? "\"" : ", \"") << pointNames[p] << "\": "
+					<< percentiles[m][p];
+			}
+			out << "},\n";
+		}
+		if (journal != NULL) {
+			out << "  \"journal_entries\": " << journal->get_sequence() << ",\n"
+				<< "  \"journal_commits\": " << journal->get_commits() << ",\n";
+		}
+		out << "  \"cores\": [";
+		for (unsigned c = 0; c < cores.size(); c++) {
+			out << (c == 0 ? "\n" : ",\n")
+				<< "    {\"jobs_completed\": " << cores[c].completed
+				<< ", \"busy_jiffies\": " << cores[c].busyTime
+				<< ", \"utilization\": "
+				<< (runClock == 0 ? 0 : (double) cores[c].busyTime / runClock)
+				<< ", \"jobs_stolen\": " << cores[c].stolen << "}";
+		}
+		out << "\n  ]\n}" << endl;
+	} else {
+		for (unsigned i = 0; i < 6; i++) {
+			out << names[i] << ": " << stats[i] << endl;
+		}
+		out << "jobs_completed: " << totalComplete << endl
+			<< "jiffies_processed: " << runClock << endl
+			<< "avg_memory_utilization: " << memUtil << endl
+			<< "peak_memory: " << memoryPeak << endl
+			<< "slices_processed: " << slices << endl;
+		for (int m = 0; m < CompletionHistograms::NUM_METRICS; m++) {
+			for (int p = 0; p < 4; p++) {
+				out << CompletionHistograms::name_of(m) << "_" << pointNames[p] << ": "
+					<< percentiles[m][p] << endl;
+			}
+		}
+		if (journal != NULL) {
+			out << "journal_entries: " << journal->get_sequence() << endl
+				<< "journal_commits: " << journal->get_commits() << endl;
+		}
+		
+		if (cores.size() > 1) {
+			for (unsigned c = 0; c < cores.size(); c++) {
+				out << "core " << c << ": jobs_completed: " << cores[c].completed
+					<< ", busy_jiffies: " << cores[c].busyTime
+					<< ", utilization: "
+					<< (runClock == 0 ? 0 : (double) cores[c].busyTime / runClock)
+					<< ", jobs_stolen: " << cores[c].stolen << endl;
+			}
+		}
+	}
+}
+
+//Written to path.tmp and renamed over path, so a reader never sees half a file
+const char *Scheduler::export_histograms(const char *path) {
+	string   temporary = string(path) + ".tmp";
+	ofstream out(temporary.c_str());
+	
+	if (out.fail()) {return "Cannot write the histograms";}
+	
+	out << "{\n  \"jobs_completed\": " << totalComplete << ",\n  \"all\": ";
+	allJobs.write_json(out);
+	
+	out << ",\n  \"levels\": [";
+	for (int p = 0; p < NUM_QUEUES; p++) {
+		out << (p == 0 ? "\n" : ",\n") << "    {\"level\": " << p << ", \"histograms\": ";
+		byLevel[p].write_json(out);
+		out << "}";
+	}
+	
+	//size class k is bursts of k + 1 digits
+	out << "\n  ],\n  \"sizes\": [";
+	for (int k = 0, low = 1; k < NUM_SIZE_CLASSES; k++, low *= 10) {
+		out << (k == 0 ? "\n" : ",\n") << "    {\"min_burst\": " << low
+			<< ", \"max_burst\": " << (k == NUM_SIZE_CLASSES - 1 ? -1 : low * 10 - 1)
+			<< ", \"histograms\": ";
+		bySize[k].write_json(out);
+		out << "}";
+	}
+	out << "\n  ]\n}" << endl;
+	
+	out.close();
+	if (out.fail() || rename(temporary.c_str(), path) != 0) {
+		unlink(temporary.c_str());
+		return "Cannot write the histograms";
+	}
+	return NULL;
+}
+
+void Scheduler::histograms_to(const char *path) {
+	histogramPath = path;
+}
+
+void Scheduler::trace_events(bool on) {
+	timeline.enable(on);
+}
+
+const char *Scheduler::export_timeline(const char *path) {
+	return timeline.write_json(path, cores.size()) ? NULL : "Cannot write the timeline";
+}
+
+void Scheduler::timeline_to(const char *path) {
+	timelinePath = path;
+	trace_events(true);
+}
+
+//Bursts of 1 to 9 jiffies are class 0, 10 to 99 class 1, ... and the last class takes
+//everything longer
+int Scheduler::size_class(int burst) {
+	int k = 0;
+	
+	for (int bound = 10; k < NUM_SIZE_CLASSES - 1 && burst >= bound; bound *= 10) {k++;}
+	return k;
+}
+
+//Jobs ingested from the feed and the worst ingestion lag so far (rounded up), next to
+//the memory in the status bar
+void Scheduler::output_feed_status() {
+	if (feed == NULL) {return;}
+	
+	win.status_bar(1, 34, "Feed jobs: %d", feed->get_jobs());
+	win.status_bar(1, 56, "Max feed lag (ms): %d", (int) feed->get_max_lag() + 1);
 }
 
 void Scheduler::output_status(int slice) {
@@ -660,21 +2201,28 @@ void Scheduler::output_status(int slice) {
 	//leading integers are specified, in which case it is row, column, str...
 	//This is the only CursesHandler function like this!
 	
+	win.begin_batch(); //the whole status in one frame
 	win.clear_status_bar();
 	win.status_bar(0, "Queue size:");
 	
-	//print the MLFQ queue sizes
-	for (unsigned i = 0; i < runs.size(); i++) {
-		win.status_bar(15 + i * 4, "%d", runs[i].size()); //print the queue size
+	//print the MLFQ queue sizes (summed over every core)
+	for (int i = 0; i < NUM_QUEUES; i++) {
+		int size = 0;
+		for (unsigned c = 0; c < cores.size(); c++) {
+			size += cores[c].runs[i].size();
+		}
+		win.status_bar(15 + i * 4, "%d", size); //print the queue size
 		win.status_bar(17 + i * 4, "|");
 	}
 	
-	win.status_bar(15 + (runs.size() * 4), "%d",      waitingOnMem.size());//waiting queue
+	win.status_bar(15 + (NUM_QUEUES * 4), "%d",       waitingOnMem.size());//waiting queue
 	win.status_bar(1, 0, "Total memory occupied: %d", memoryUsed);		   //memory used
+	output_feed_status();
 	
-	win.core_bar(0, "PID: %d ", 			    current->get_pid());
+	win.core_bar(0, "PID: %d (core %d)", current->get_pid(), core - &cores[0]);
 	win.core_bar(1, "Priority: %d",			    priority);
 	win.core_bar(2, "Burst time remaining: %d", current->get_exec_time());
 	win.core_bar(3, "Time slice allocated: %d", slice);
+	win.end_batch();
 }
 
@@ -2,26 +2,128 @@
 #define __Scheduler_h__
 
 #include <vector>
+#include <string>
 #include <fstream>
 #include <curses.h>
+#include <sys/types.h>
 #include "Job.h"
 #include "JobHashTable.h"
+#include "JobArena.h"
+#include "PidSet.h"
 #include "JobQueue.h"
 #include "CursesHandler.h"
+#include "WorkerPool.h"
+#include "MPSCQueue.h"
+#include "LevelBitmap.h"
+#include "AdmissionQueue.h"
+#include "TraceReader.h"
+#include "JobFeed.h"
+#include "Checkpoint.h"
+#include "Journal.h"
+#include "Histogram.h"
+#include "Timeline.h"
 
 class Scheduler {
 	public:
-		 Scheduler(int baseQuantum, int numQueues, bool varyQuanta, bool chainWeighting);
+		 Scheduler(int baseQuantum, int numQueues, bool varyQuanta, bool chainWeighting,
+		 		   bool criticalPath, bool headless, int numCores, bool parallel,
+		 		   AdmissionQueue::Policy admitPolicy, int maxBypass);
 		~Scheduler();
 
 		//Runtime loop that exists until exit specified by user (or exception thrown)
     	void run();
+    	
+    	//Headless batch mode: load every job from trace, then run the MLFQ on the
+    	//virtual clock (no sleeping) until there is nothing left that can be processed.
+    	//Jobs submit()ted meanwhile arrive whenever they are ingested, with no virtual
+    	//arrival time (see fast_forward())
+    	void run_headless(TraceReader &trace);
+    	
+    	//Headless, for jobs that arrive over virtual time: run the MLFQ until the clock
+    	//reaches clock (or it has nothing left to run, in which case it idles up to clock)
+    	//and stop with whatever is left still queued. Jobs submit()ted in between arrive
+    	//at that time. Finish with run_headless() on an empty trace
+    	void run_headless_until(int clock);
+    	
+    	//Make a job from every record in trace and return how many were made; bad records
+    	//are reported to the trace (see TraceReader::get_errors())
+    	int load_jobs(TraceReader &trace);
+    	
+    	//Thread safe: add a job from any thread, at any time, without ever blocking. The
+    	//job is queued and made between slices of run() (or run_headless()), exactly like
+    	//a job read from a file; an invalid job is reported then
+    	void submit(int pid, int execTime, int resources, const std::vector<int> &deps);
+    	
+    	//Cancel the job with this PID and every job downstream of it (that depends on it,
+    	//directly or not): each is taken out of whatever queue it is in, gives back its
+    	//memory and is forgotten. Return how many were cancelled (0 if there is no such
+    	//job left). Not thread safe; from the thread running the MLFQ, e.g. between calls
+    	//to run_headless_until()
+    	int cancel(int pid);
+    	
+    	//Keep reading jobs from the FIFO or append-only file at path while run() runs.
+    	//Return false if it cannot be opened
+    	bool follow(const char *path);
+    	
+    	//Print the statistics as plain text or as a JSON object
+    	void print_stats(std::ostream &out, bool json);
+    	
+    	//Write the latency, response, turnaround and slowdown histograms of every job
+    	//completed so far (see Histogram.h) to path as JSON: over all jobs, by the level
+    	//each completed at, and by burst time size class. Return an error, or NULL
+    	const char *export_histograms(const char *path);
+    	
+    	//Where h in the menu exports them (else it asks for a file)
+    	void histograms_to(const char *path);
+    	
+    	//Record every slice, demotion, admission, completion and dependency release from
+    	//now on (or stop), and write what has been recorded to path as a Chrome trace
+    	//(see Timeline.h). Return an error, or NULL
+    	void 		trace_events(bool on);
+    	const char *export_timeline(const char *path);
+    	
+    	//Trace from the start, and make path where t in the menu exports the timeline
+    	void timeline_to(const char *path);
+    	
+    	//Snapshot the whole state (every queue in order, the jobs with their edges, memory,
+    	//clocks and statistics) to path without stopping: a fork()ed child writes it from
+    	//its copy-on-write image of the process while the MLFQ carries on. Return false if
+    	//the last checkpoint is still being written or there is no process to spare; how
+    	//the write went is reported once it is done
+    	bool checkpoint(const char *path);
+    	
+    	//Also checkpoint to path every interval jiffies of virtual time (0: only when the
+    	//user asks for one from the menu)
+    	void checkpoint_every(const char *path, int interval);
+    	
+    	//Every interval jiffies of a core's clock, move every job on that core back to
+    	//its top priority, so long jobs that sank to the bottom cannot be starved by a
+    	//stream of short ones (0: never, the default). See boost()
+    	void boost_every(int interval);
+    	
+    	//Take over the state checkpointed to path, in time linear in its size. Only for a
+    	//new Scheduler created with the same BASE, QUEUENUM, -c, -p, -q and
+    	//number of cores.
+    	//Return NULL, or what is wrong (then this Scheduler is half restored; delete it)
+    	const char *restore(const char *path);
+    	
+    	//Replay the journal at path on top of the state so far (a new Scheduler, or one
+    	//just restored, in which case the entries its checkpoint already includes are
+    	//skipped), then keep journaling to it: from now on every job made, killed or
+    	//completed is appended, and committed by a background thread every interval
+    	//milliseconds (see Journal.h). Return NULL, or what is wrong
+    	const char *journal_to(const char *path, int interval);
 
 	private:
 		//Constants///////////////////////////////////////////////////////////////////////
 		
     	static const int MAX_MEMORY = 1000; // Arbitrary unit -- could be KB
     	static const unsigned long JIFFIE_TIME = 100;
+    	static const unsigned MAX_LOAD_ERRORS = 20; //headless: errors printed in full
+    	static const int MAX_SUBMIT_BATCH = 4096; //submitted jobs made per ingest()
+    	enum CancelMark {UNMARKED, CANCELLED, DEPENDED_ON}; //see cancel_subgraph()
+    	static const char CHECKPOINT_MAGIC[8]; //first and last 8 bytes of a checkpoint
+    	static const char CHECKPOINT_END[8];
     	//A jiffie is an arbitrary unit of time, and is the minimum unit for which
     	//the CPU must process work. The JIFFIE_TIME constant represents number of
     	//microseconds of wallclock time equivalent to one jiffie of work in realtime
@@ -31,65 +133,167 @@ class Scheduler {
 	    int BASE_QUANTUM;	   //Baseline quantum -- see ReadMe
 	    bool VARY_QUANTA;	   //Mode flags -- see ReadMe
 		bool CHAIN_WEIGHTING;
+		bool CRITICAL_PATH;	   //Chain Weighting Mode, with chains measured in work
+		bool HEADLESS;		   //No NCurses and no wallclock sleeping -- see run_headless
+		
+	    int NUM_QUEUES;		   //Number of priorities in every core's MLFQ
+		
+		//A simulated core. Every core has its own MLFQ and its own clock, which is the
+		//virtual time up to which it has processed work. The Scheduler always steps the
+		//busy core that is furthest behind, so slices on different cores interleave in
+		//(roughly) the order they would happen on real hardware
+		struct Core {
+			std::vector<JobQueue> runs; //A vector of queues of pointers to running jobs
+			LevelBitmap nonEmpty;		//bit p is set iff runs[p] is not empty
+			int clock;     //virtual time this core has reached
+			int busyTime;  //jiffies actually spent processing (clock minus idle time)
+			int load;      //number of jobs in runs
+			int completed; //number of jobs this core completed
+			int stolen;    //number of jobs this core stole from other cores
+			bool busy;     //parallel mode: a worker is processing a slice for this core
+			Job *inFlight; //...for this job (NULL if the job was killed meanwhile)
+			int nextBoost; //clock at which the next priority boost is due
+		};
 		
 		//Objects/////////////////////////////////////////////////////////////////////////
 
 		CursesHandler win; //The window which processes all non-fstream I/O
     	
-    	std::vector<JobQueue> runs; //A vector of queues of pointers to running jobs
+    	std::vector<Core> cores; //One MLFQ per simulated core
+    	
+    	WorkerPool *pool; //Parallel mode only: one worker thread per core (else NULL)
+    	
+    	MPSCQueue<TraceReader::Record> submitted; //jobs from submit(), see ingest()
+    	
+    	JobFeed *feed; //Live job source polled between slices, see follow() (else NULL)
+    	std::vector<TraceReader::Record> feedRecords; //reused by every ingest()
+    	std::vector<TraceReader::Error>  feedErrors;
+    	
+    	pid_t 		checkpointChild;	//process writing the last checkpoint (else -1)
+    	int 		checkpointClock;	//...as of this runClock
+    	std::string checkpointPath;		//see checkpoint_every()
+    	int 		checkpointInterval;
+    	int 		nextCheckpoint;		//runClock of the next periodic checkpoint
+    	
+    	int boostInterval; //see boost_every() (0: never)
+    	
+    	Journal *journal;		  //see journal_to() (else NULL)
+    	int64_t  journalSequence; //last journal entry included in the state, if no journal
 
+    	JobArena arena; //Owns every Job and its dependency and successor lists
+    	
     	JobHashTable jobs; //A hashtable of pointers to all Jobs including those
-    					   //that are latent, waiting, running, and completed
+    					   //that are latent, waiting, and running
+    	PidSet completed;  //...and the PIDs of those that completed
     					   
-    	JobQueue waitingOnMem; //If a job has no dependencies but there is not enough
-    						   //memory available, they wait here (right now it is
-    						   //simple FIFO - must pop from the front even if a big
-    						   //job is clogging up the queue)
+    	AdmissionQueue waitingOnMem; //If a job has no dependencies but there is not
+    								 //enough memory available, it waits here until the
+    								 //admission policy lets it in (see AdmissionQueue.h)
     	
     	//Variables///////////////////////////////////////////////////////////////////////
     	
 		int memoryUsed; //Total memory used by all current processes
+		int memoryPeak; //...and the most it has ever been
+		long long memoryJiffies; //memoryUsed integrated over runClock, up to memoryClock
+		int memoryClock;
 		
     	//Changes per processor iteration but stored for easy access by methods:
+    	Core *core;    //core that is processing current
     	Job *current;  //current job being processed
     	int  priority; //current priority of current job
     	bool paused;   //whether processing loop is paused
     	bool exit;     //end the program if true
     	
+    	//Reused by every deep_search_update so it never allocates once warmed up
+    	int chainStamp; 			   //incremented per update; see JobChain::chainMark
+    	std::vector<uint32_t> chainStack; //worklist of both passes (job ids)
+    	
+    	//Reused by every cancel_subgraph(), and left all UNMARKED after each
+    	std::vector<uint8_t>  cancelMarks; //a CancelMark per job id
+    	std::vector<uint32_t> cancelled;   //the jobs being cancelled (ids)
+    	std::vector<uint32_t> cancelDeps;  //the jobs outside them they depended on
+    	
     	//Used for computing statistics
-    	int    runClock; //total jiffies processed since initialization
+    	int    runClock; //latest virtual time reached by any core
+    	long long slices; //slices processed, counting those fast_forward() skipped over
     	int    totalComplete; //num jobs completed
-		int    totalLatency; //
-		int    totalTurnaround;
-		int    totalResponse;
+		long long totalLatency; //summed over the jobs completed
+		long long totalTurnaround;
+		long long totalResponse;
 		double totalTurnPerBurst;
 		double totalLatencyPerBurst;
 		
+		//The distributions behind the averages, recorded per completion (see Histogram.h)
+		static const int NUM_SIZE_CLASSES = 6; //bursts of 1, 2, ... 6 or more digits
+		CompletionHistograms allJobs;
+		std::vector<CompletionHistograms> byLevel; //the level a job completed at
+		std::vector<CompletionHistograms> bySize;  //its size_class()
+		std::string histogramPath;
+		
+		Timeline 	timeline; //event tracing, off unless asked for
+		std::string timelinePath;
+		
 		//Methods used for scheduling and processing//////////////////////////////////////
 		
 		void start_processing(Job *new_process);
-		void deep_search_update(Job *j, int num);  
+		Core *least_loaded_core();
+		void steal_for_idle_cores();
+		void deep_search_update(Job *j, long long num);
+		long long chain_weight (uint32_t k);
+		void shrink_chains	   ();
     	void move_from_waiting();
     	bool find_next_priority();
     	void update_successors();
     	void process_job();
+    	int  run_slice();
+    	void end_slice(int slice);
+    	bool pick_from_core(Core *c);
+    	void boost(Core *c);
+    	void push_run  (Core *c, int level, Job *j);
+    	void remove_run(Core *c, int level, Job *j);
+    	bool dispatch_slices();
+    	void collect_slices();
+    	void drop_in_flight(Job *j);
+    	void unqueue(Job *j);
+    	Core *core_of(JobQueue *q);
+    	int  slice_for(Job *j, int p);
+    	int  fast_forward();
     	void complete_processing();
+    	void retire(Core *c, int level);
+    	void kill(Job *j);
+    	int  cancel_subgraph(Job *j);
+    	uint8_t &cancel_mark(uint32_t id);
+    	void replay(Journal::Entry &e);
+    	void journal_insert(TraceReader::Record &r);
+    	void ingest();
+    	void tend_checkpoints();
+    	bool reap_checkpoint(bool wait);
+    	bool write_checkpoint(const char *path);
+    	void output_feed_status();
+    	void use_memory(int amount);
     	
     	//Methods used for IO handling////////////////////////////////////////////////////
 
-    	bool make_job_from_line (std::istream &inFile);
-    	bool file_error		    (std::string str, int pid,  std::istream &inFile);
-    	int get_dependent_pid   (bool externalFile, int i,  std::istream &inFile);
-    	void read_dependencies  (Job *j, bool externalFile, std::istream &inFile);
+    	const char *make_job_from_record(TraceReader::Record &r);
+    	void read_dependencies    (Job *j);
+    	void add_dependency	      (Job *j, int pid);
     	void convert_to_latent  (Job *j);
+    	void detach			    (Job *j);
+    	std::vector<int> pids_of(JobList &list);
+    	int  longest_chain	    (Job *j);
     	void job_on_console     (Job *j);
     	void kill_check_continue(Job *j);
+    	void cancel_check_continue(Job *j);
     	void main_menu_input    (char input);
     	void output_status      (int  slice);
     	void lookup_from_input();
     	void kill_job();
     	void add_from_file();
-    	void update_stats();
+    	void checkpoint_from_input();
+    	void histograms_from_input();
+    	void timeline_from_input();
+    	void update_stats(int level);
+    	static int size_class(int burst);
     	void make_job_from_cin();
     	int  cin_pid();
     	int  cin_exec_time();
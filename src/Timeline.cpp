@@ -0,0 +1,175 @@
+/*
+ * Timeline.cpp
+ * see Timeline.h for details
+ */
+
+#include <fstream>
+#include <string>
+#include <stdio.h>
+#include <unistd.h>
+#include "Timeline.h"
+
+using namespace std;
+
+atomic<uint64_t> 	  Timeline::nextId(1);
+thread_local uint64_t Timeline::cachedOwner = 0;
+thread_local Timeline::Ring *Timeline::cachedRing = NULL;
+
+Timeline::Timeline(size_t eventsPerThread) {
+	size_t size = 1;
+
+	while (size < eventsPerThread) {size *= 2;}
+	mask 	= size - 1;
+	id 		= nextId++;
+	enabled = false;
+}
+
+Timeline::~Timeline() {
+	for (unsigned i = 0; i < rings.size(); i++) {delete rings[i];}
+}
+
+void Timeline::enable(bool on) {
+	enabled.store(on, memory_order_relaxed);
+}
+
+Timeline::Ring *Timeline::ring_of_this_thread() {
+	lock_guard<mutex> guard(lock);
+	Ring *r = NULL;
+
+	for (unsigned i = 0; i < rings.size() && r == NULL; i++) {
+		if (rings[i]->thread == this_thread::get_id()) {r = rings[i];}
+	}
+	if (r == NULL) {
+		r = new Ring;
+		r->thread = this_thread::get_id();
+		r->events.resize(mask + 1);
+		r->head = 0;
+		rings.push_back(r);
+	}
+
+	cachedOwner = id;
+	cachedRing  = r;
+	return r;
+}
+
+//Append what r still holds to out, oldest first. Events the writer may have overwritten
+//while they were being copied (it lapped them) are dropped
+void Timeline::copy(Ring *r, vector<Event> &out) {
+	uint64_t size  = mask + 1;
+	uint64_t head  = r->head.load(memory_order_acquire);
+	uint64_t first = head > size ? head - size : 0;
+	size_t 	 start = out.size();
+
+	for (uint64_t i = first; i < head; i++) {out.push_back(r->events[i & mask]);}
+
+	uint64_t after = r->head.load(memory_order_acquire);
+	uint64_t valid = after > size ? after - size : 0; //oldest not overwritten since
+
+	if (valid > first) {
+		out.erase(out.begin() + start, out.begin() + start + (valid - first));
+	}
+}
+
+//One trace event; see Timeline::Type for what a and b are
+static void write_event(ostream &out, const Timeline::Event &e, int admissionTrack) {
+	const char *instants[] = {"", "", "demote", "admit", "complete", "release"};
+	int tid = e.type == Timeline::ADMIT || e.type == Timeline::RELEASE ?
+			  admissionTrack : e.core;
+
+	switch (e.type) {
+		case Timeline::SLICE:
+			out << "{\"name\": \"job " << e.pid << "\", \"cat\": \"slice\", \"ph\": \"X\""
+				<< ", \"ts\": " << e.clock << ", \"dur\": " << e.a
+				<< ", \"pid\": 0, \"tid\": " << tid
+				<< ", \"args\": {\"pid\": " << e.pid << ", \"level\": " << e.level
+				<< "}}";
+			break;
+		case Timeline::FAST_FORWARD:
+			out << "{\"name\": \"fast forward\", \"cat\": \"slice\", \"ph\": \"X\""
+				<< ", \"ts\": " << e.clock << ", \"dur\": " << e.a
+				<< ", \"pid\": 0, \"tid\": " << tid
+				<< ", \"args\": {\"jobs\": " << e.pid << ", \"rounds\": " << e.b << "}}";
+			break;
+		case Timeline::BOOST:
+			out << "{\"name\": \"boost\", \"cat\": \"mlfq\", \"ph\": \"i\", \"s\": \"t\""
+				<< ", \"ts\": " << e.clock << ", \"pid\": 0, \"tid\": " << tid
+				<< ", \"args\": {\"jobs\": " << e.pid << ", \"to\": " << e.level << "}}";
+			break;
+		case Timeline::MEMORY:
+			out << "{\"name\": \"memory\", \"ph\": \"C\", \"ts\": " << e.clock
+				<< ", \"pid\": 0, \"args\": {\"used\": " << e.a
+				<< ", \"waiting\": " << e.b << "}}";
+			break;
+		default:
+			out << "{\"name\": \"" << instants[e.type] << "\", \"cat\": \"mlfq\""
+				<< ", \"ph\": \"i\", \"s\": \"t\", \"ts\": " << e.clock
+				<< ", \"pid\": 0, \"tid\": " << tid << ", \"args\": {\"pid\": " << e.pid;
+			if (e.type == Timeline::DEMOTE) {
+				out << ", \"from\": " << e.level << ", \"to\": " << e.b;
+			} else if (e.type == Timeline::ADMIT) {
+				out << ", \"core\": " << e.core << ", \"resources\": " << e.a;
+			} else if (e.type == Timeline::COMPLETE) {
+				out << ", \"level\": " << e.level;
+			} else {
+				out << ", \"dependency\": " << e.a;
+			}
+			out << "}}";
+			break;
+	}
+}
+
+//Written to path.tmp and renamed over path, like the histograms
+bool Timeline::write_json(const char *path, int numCores) {
+	vector<Event> events;
+	{
+		lock_guard<mutex> guard(lock);
+		for (unsigned i = 0; i < rings.size(); i++) {copy(rings[i], events);}
+	}
+
+	string   temporary = string(path) + ".tmp";
+	ofstream out(temporary.c_str());
+
+	if (out.fail()) {return false;}
+
+	out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"
+		<< "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0"
+		<< ", \"args\": {\"name\": \"SharkBatch (1 us = 1 jiffy)\"}}";
+	for (int c = 0; c <= numCores; c++) {
+		out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << c
+			<< ", \"args\": {\"name\": \"";
+		if (c < numCores) {out << "core " << c;}
+		else 			  {out << "admission";}
+		out << "\"}}";
+	}
+	for (size_t i = 0; i < events.size(); i++) {
+		out << ",\n";
+		write_event(out, events[i], numCores);
+	}
+	out << "\n]}" << endl;
+
+	out.close();
+	if (out.fail() || rename(temporary.c_str(), path) != 0) {
+		unlink(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+long long Timeline::get_recorded() {
+	lock_guard<mutex> guard(lock);
+	long long recorded = 0;
+
+	for (unsigned i = 0; i < rings.size(); i++) {recorded += rings[i]->head.load();}
+	return recorded;
+}
+
+long long Timeline::get_kept() {
+	lock_guard<mutex> guard(lock);
+	long long kept = 0;
+
+	for (unsigned i = 0; i < rings.size(); i++) {
+		uint64_t head = rings[i]->head.load();
+		kept += head > mask + 1 ? mask + 1 : head;
+	}
+	return kept;
+}
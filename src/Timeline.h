@@ -0,0 +1,112 @@
+/*
+ * Timeline
+ *
+ * Event tracing for finding scheduling pathologies after the fact: every slice,
+ * demotion, boost, admission, completion and dependency release is recorded with the
+ * virtual time it happened at, and write_json() turns the lot into a Chrome trace (the
+ * JSON that chrome://tracing and ui.perfetto.dev open), one track per core plus one for
+ * admissions, with a jiffy shown as a microsecond.
+ *
+ * RECORDING is meant to be left on. Every thread that records gets a ring buffer of its
+ * own (the Scheduler thread, and in parallel mode each worker for the slices it runs),
+ * allocated the first time it records, so recording takes no lock and shares no cache
+ * line: it is a check of the enabled flag, a thread_local lookup, a 24 byte store and a
+ * release store of the ring's head. A ring keeps the last eventsPerThread events; older
+ * ones are overwritten, so a long run keeps its most recent history at a fixed cost.
+ * Disabled, record() is a single relaxed load.
+ *
+ * FLUSHING may happen while other threads record: write_json() copies each ring up to
+ * its head, then drops whatever the writer may have lapped in the meantime.
+ */
+
+#ifndef TIMELINE_H_
+#define TIMELINE_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+
+class Timeline {
+	public:
+		enum Type {
+			SLICE,		  //pid ran on core at level for a jiffies
+			FAST_FORWARD, //pid (here a count) jobs ran b whole rounds, a jiffies in all
+			DEMOTE, 	  //pid went from level to level b on core
+			ADMIT, 		  //pid got a memory and went to core, needing a
+			COMPLETE, 	  //pid completed on core at level
+			RELEASE, 	  //pid's last dependency, a, completed; it now waits on memory
+			MEMORY, 	  //a memory in use, b jobs waiting on it
+			BOOST 		  //pid (here a count) jobs on core went back up to level
+		};
+
+		struct Event {
+			int32_t clock; //virtual time
+			int32_t pid;
+			int32_t a;
+			int32_t b;
+			int16_t type;
+			int16_t level;
+			int16_t core;
+		};
+
+		static const size_t DEFAULT_EVENTS = 1 << 20; //per thread (24 MB)
+
+		 Timeline(size_t eventsPerThread); //rounded up to a power of two
+		~Timeline();
+
+		void enable(bool on);
+		bool is_enabled() {return enabled.load(std::memory_order_relaxed);}
+
+		//Any thread
+		void record(Type type, int clock, int core, int level, int pid, int a, int b) {
+			if (!enabled.load(std::memory_order_relaxed)) {return;}
+
+			Event e = {clock, pid, a, b, (int16_t) type, (int16_t) level, (int16_t) core};
+			record(e);
+		}
+		void record(const Event &e) {
+			if (!enabled.load(std::memory_order_relaxed)) {return;}
+
+			Ring 	*r = cachedOwner == id ? cachedRing : ring_of_this_thread();
+			uint64_t h = r->head.load(std::memory_order_relaxed);
+
+			r->events[h & mask] = e;
+			r->head.store(h + 1, std::memory_order_release);
+		}
+
+		//Write every event still in the rings to path as a Chrome trace, oldest first
+		//per thread. False if it cannot be written
+		bool write_json(const char *path, int numCores);
+
+		long long get_recorded(); //events ever recorded
+		long long get_kept();	  //...of which the rings still hold
+
+	private:
+		struct Ring {
+			std::thread::id 	  thread; //the only one that records here
+			std::vector<Event> 	  events;
+			std::atomic<uint64_t> head; //events ever recorded here
+		};
+
+		uint64_t id;	 //unique over every Timeline ever made, for the cache below
+		size_t 	 mask; //ring size - 1
+
+		std::atomic<bool>  enabled;
+		std::mutex 		   lock; //guards rings
+		std::vector<Ring*> rings;
+
+		static std::atomic<uint64_t> nextId;
+		static thread_local uint64_t cachedOwner; //id of the Timeline cachedRing is in
+		static thread_local Ring	 *cachedRing;
+
+		Ring *ring_of_this_thread(); //found under the lock (made the first time)
+		void  copy(Ring *r, std::vector<Event> &out);
+
+		//Not copyable
+		Timeline(const Timeline &);
+		Timeline &operator=(const Timeline &);
+};
+
+#endif /* TIMELINE_H_ */
@@ -0,0 +1,390 @@
+/*
+ * TraceReader.cpp
+ * see TraceReader.h for details
+ */
+
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdint.h>
+#include "TraceReader.h"
+
+using namespace std;
+
+const char TraceReader::MAGIC[8] = {'S', 'H', 'R', 'K', 'T', 'R', 'C', 'E'};
+
+TraceReader::TraceReader() {
+	data   = NULL;
+	end    = NULL;
+	pos    = NULL;
+	mapped = 0;
+	line   = 1;
+	fd     = -1;
+	binary = false;
+	chunkLeft = 0;
+	edges     = NULL;
+}
+
+TraceReader::~TraceReader() {
+	close();
+}
+
+void TraceReader::close() {
+	if (mapped > 0) {munmap((void *) data, mapped);}
+	if (fd > 0) 	{::close(fd);}
+
+	buffer.clear();
+	data = end = pos = edges = NULL;
+	mapped    = 0;
+	fd        = -1;
+	chunkLeft = 0;
+}
+
+bool TraceReader::open(const char *fileName) {
+	int file = fileName == NULL ? 0 : ::open(fileName, O_RDONLY);
+	struct stat st;
+
+	close();
+	errors.clear();
+	line   = 1;
+	binary = false;
+
+	if (file < 0 || fstat(file, &st) != 0) {
+		if (file > 0) {::close(file);}
+		return false;
+	}
+
+	if (S_ISREG(st.st_mode) && st.st_size > 0) {
+		void *m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+		if (m != MAP_FAILED) {
+			madvise(m, st.st_size, MADV_SEQUENTIAL);
+			data   = (const char *) m;
+			mapped = st.st_size;
+			binary = mapped >= sizeof(MAGIC) && memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+			end    = data + mapped;
+		}
+	}
+
+	//Not mappable (a pipe, or mmap refused): read as much as a binary header first. A
+	//binary trace is then read one chunk at a time from fd; text is read whole into the
+	//buffer
+	if (mapped == 0) {
+		fd = file;
+		buffer.resize(HEADER_SIZE);
+		buffer.resize(read_fully(&buffer[0], HEADER_SIZE));
+		binary = buffer.size() >= sizeof(MAGIC) &&
+				 memcmp(&buffer[0], MAGIC, sizeof(MAGIC)) == 0;
+
+		if (!binary) {
+			char    chunk[65536];
+			ssize_t n;
+
+			while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+				buffer.insert(buffer.end(), chunk, chunk + n);
+			}
+			fd = -1;
+		}
+		data = buffer.empty() ? NULL : &buffer[0];
+		end  = data + buffer.size();
+	}
+
+	if (fd != file && file > 0) {::close(file);}
+
+	pos = data;
+	line = binary ? 0 : 1;
+
+	if (binary) {
+		if (end - data < (long) HEADER_SIZE) {
+			report(0, "binary trace: header is cut short");
+		} else if (trace_get32(data + sizeof(MAGIC)) != VERSION) {
+			report(0, "binary trace: unsupported version");
+		} else {
+			edges = data + HEADER_SIZE; //where the first chunk starts, if mapped
+			return true;
+		}
+		close(); //no records
+	}
+	return true;
+}
+
+void TraceReader::open_memory(const char *text, size_t size) {
+	close();
+	errors.clear();
+	binary = false;
+	line   = 1;
+	data   = text;
+	end    = text + size;
+	pos    = data;
+}
+
+bool TraceReader::next(Record &r) {
+	if (binary) {return next_binary(r);}
+
+	while (true) {
+		skip_space();
+		if (pos == end) {return false;}
+
+		r.line = line;
+		r.deps.clear();
+
+		bool ok = parse_int(r.pid, r.line) && parse_int(r.execTime, r.line) &&
+				  parse_int(r.resources, r.line);
+		int  dep = 0;
+
+		while (ok && (ok = parse_int(dep, r.line)) && dep != -1) {
+			r.deps.push_back(dep);
+		}
+
+		if (ok) {return true;}
+		skip_line();
+	}
+}
+
+void TraceReader::report(int line, string message) {
+	Error e = {line, message};
+	errors.push_back(e);
+}
+
+vector<TraceReader::Error> &TraceReader::get_errors() {
+	return errors;
+}
+
+size_t TraceReader::get_size() {
+	return end - data;
+}
+
+bool TraceReader::is_binary() {
+	return binary;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+void TraceReader::skip_space() {
+	while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r')) {
+		if (*pos == '\n') {line++;}
+		pos++;
+	}
+}
+
+//Skip to just past the next newline (used to resynchronize after an error, the same as
+//the old istream loader did)
+void TraceReader::skip_line() {
+	const char *nl = (const char *) memchr(pos, '\n', end - pos);
+
+	pos = nl == NULL ? end : nl + 1;
+	if (nl != NULL) {line++;}
+}
+
+//Parse one (optionally negative) integer after any whitespace. On an error, report it
+//and return false with pos somewhere on the offending line. Running out of input is
+//reported on recordLine, where the unfinished record started
+bool TraceReader::parse_int(int &value, int recordLine) {
+	skip_space();
+
+	if (pos == end) {
+		report(recordLine, "unexpected end of file (missing -1?)");
+		return false;
+	}
+
+	bool negative = *pos == '-';
+	long long n = 0;
+	int  digits = 0;
+
+	if (negative) {pos++;}
+
+	while (true) {
+		int len = 0;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		if (end - pos >= 8) {
+			//A byte b is a digit iff its high nibble is 3 both before and after adding 6.
+			//m has a nonzero byte at every non-digit; the lowest one ends the number (a
+			//carry out of a non-digit byte can only spoil the bytes after it)
+			uint64_t w;
+			memcpy(&w, pos, 8);
+
+			uint64_t m = ((w & 0xF0F0F0F0F0F0F0F0ULL) ^ 0x3030303030303030ULL) |
+						 (((w + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) ^
+						  0x3030303030303030ULL);
+			uint64_t nonDigit = (((m & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | m)
+								& 0x8080808080808080ULL;
+
+			len = nonDigit == 0 ? 8 : __builtin_ctzll(nonDigit) / 8;
+
+			if (len > 0) {
+				//Shift the digits to the top so the missing ones become leading zeros,
+				//then combine neighbouring digits, pairs, and quads with one multiply each
+				uint64_t v = (w & 0x0F0F0F0F0F0F0F0FULL) << (8 * (8 - len));
+
+				v = (v * 10 + (v >> 8)) & 0x00FF00FF00FF00FFULL;
+				v = (v * 100 + (v >> 16)) & 0x0000FFFF0000FFFFULL;
+				v = (v * 10000 + (v >> 32)) & 0x00000000FFFFFFFFULL;
+
+				static const long long POW10[] = {1, 10, 100, 1000, 10000, 100000,
+												  1000000, 10000000, 100000000};
+				n = n * POW10[len] + (long long) v;
+			}
+		} else
+#endif
+		{
+			while (pos + len < end && pos[len] >= '0' && pos[len] <= '9' && len < 8) {
+				n = n * 10 + (pos[len] - '0');
+				len++;
+			}
+		}
+
+		pos    += len;
+		digits += len;
+
+		if (len < 8 || digits > 10) {break;}
+	}
+
+	if (digits == 0 || (pos < end && *pos != ' ' && *pos != '\t' && *pos != '\n' &&
+						*pos != '\r')) {
+		report(line, "expected an integer");
+		return false;
+	}
+	if (digits > 10 || n > (long long) INT_MAX + negative) {
+		report(line, "integer out of range");
+		return false;
+	}
+
+	value = (int) (negative ? -n : n);
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// Binary traces
+
+//A record is 16 bytes at pos and its numDeps dependencies at edges, which load_chunk()
+//has already checked are all inside the chunk
+bool TraceReader::next_binary(Record &r) {
+	while (chunkLeft == 0) {
+		if (!load_chunk()) {return false;}
+	}
+
+	uint32_t numDeps = trace_get32(pos + 12);
+
+	r.line      = ++line;
+	r.pid       = (int) trace_get32(pos);
+	r.execTime  = (int) trace_get32(pos + 4);
+	r.resources = (int) trace_get32(pos + 8);
+	r.deps.resize(numDeps);
+	for (uint32_t i = 0; i < numDeps; i++) {
+		r.deps[i] = (int) trace_get32(edges + 4 * i);
+	}
+
+	pos   += RECORD_SIZE;
+	edges += 4 * (size_t) numDeps;
+	chunkLeft--;
+	return true;
+}
+
+//Make the next chunk current: pos at its first record and edges at its first dependency.
+//Mapped, the chunk is used in place (it starts where the last one's edges ended);
+//otherwise it is read into the buffer. Return false at the end, or if the chunk is cut
+//short or its numDeps do not add up (then the rest of the trace is dropped)
+bool TraceReader::load_chunk() {
+	const char *chunk;
+	size_t jobs, numEdges, body;
+
+	if (fd < 0) {
+		if (edges == NULL || edges == end) {return false;}
+
+		chunk = edges;
+		if ((size_t) (end - chunk) < CHUNK_HEADER_SIZE) {
+			report(line + 1, "binary trace: chunk header is cut short");
+			close();
+			return false;
+		}
+		jobs     = trace_get32(chunk);
+		numEdges = trace_get32(chunk + 4);
+		body     = jobs * RECORD_SIZE + numEdges * 4;
+		chunk   += CHUNK_HEADER_SIZE;
+
+		if ((size_t) (end - chunk) < body) {
+			report(line + 1, "binary trace: chunk is cut short");
+			close();
+			return false;
+		}
+	} else {
+		char   head[CHUNK_HEADER_SIZE];
+		size_t got = read_fully(head, CHUNK_HEADER_SIZE);
+
+		if (got == 0) {close(); return false;}
+		if (got < CHUNK_HEADER_SIZE) {
+			report(line + 1, "binary trace: chunk header is cut short");
+			close();
+			return false;
+		}
+		jobs     = trace_get32(head);
+		numEdges = trace_get32(head + 4);
+		body     = jobs * RECORD_SIZE + numEdges * 4;
+
+		//Grow the buffer as the bytes arrive, so a corrupt size cannot allocate more
+		//than is actually there
+		buffer.clear();
+		for (got = 0; got < body; ) {
+			size_t step = body - got < (1 << 20) ? body - got : (1 << 20);
+
+			buffer.resize(got + step);
+			size_t n = read_fully(&buffer[got], step);
+			got += n;
+			if (n < step) {break;}
+		}
+		if (got < body) {
+			report(line + 1, "binary trace: chunk is cut short");
+			close();
+			return false;
+		}
+		chunk = buffer.empty() ? NULL : &buffer[0];
+		data  = chunk;
+		end   = chunk + body;
+	}
+
+	uint64_t total = 0;
+	for (size_t i = 0; i < jobs; i++) {
+		total += trace_get32(chunk + i * RECORD_SIZE + 12);
+	}
+	if (total != numEdges) {
+		report(line + 1, "binary trace: dependency counts of a chunk do not add up");
+		close();
+		return false;
+	}
+
+	pos       = chunk;
+	edges     = chunk + jobs * RECORD_SIZE;
+	chunkLeft = jobs;
+	return true;
+}
+
+//read() from fd until n bytes are in or the input ends; return how many bytes were read
+size_t TraceReader::read_fully(char *dst, size_t n) {
+	size_t got = 0;
+
+	while (got < n) {
+		ssize_t r = read(fd, dst + got, n - got);
+
+		if (r <= 0) {break;}
+		got += r;
+	}
+	return got;
+}
+
+uint32_t trace_get32(const char *p) {
+	const unsigned char *b = (const unsigned char *) p;
+
+	return (uint32_t) b[0] | (uint32_t) b[1] << 8 | (uint32_t) b[2] << 16 |
+		   (uint32_t) b[3] << 24;
+}
+
+void trace_put32(char *p, uint32_t v) {
+	p[0] = (char) v;
+	p[1] = (char) (v >> 8);
+	p[2] = (char) (v >> 16);
+	p[3] = (char) (v >> 24);
+}
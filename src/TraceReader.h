@@ -0,0 +1,114 @@
+/*
+ * TraceReader
+ *
+ * Reads a job file (a "trace") in either of two formats, told apart by the first bytes.
+ *
+ * TEXT: the format of sample-datasets/: whitespace separated integers, one job per record
+ *
+ *		pid execTime resources dep dep ... -1
+ *
+ * Regular files are mmapped and parsed in place, so nothing is copied and there is no
+ * stream machinery between the bytes and the integers. Anything else (a pipe, a
+ * terminal) is read into one buffer first. Integers are parsed eight digits at a time:
+ * one 64 bit load, a few masks to find where the digits end, and three multiplies to
+ * combine them (SWAR -- SIMD within a register).
+ *
+ * BINARY (written by TraceWriter, e.g. with sharkbatch-convert): nothing to parse at all.
+ * All integers are little endian:
+ *
+ *		header:	"SHRKTRCE", uint32 version (1), uint32 jobs per chunk,
+ *				uint64 total jobs, uint64 total dependencies (both 0 if unknown)
+ *		chunks:	uint32 jobs, uint32 dependencies, then
+ *				one 16 byte record per job: int32 pid, execTime, resources, numDeps
+ *				the dependencies of all those jobs, int32 each, in job order
+ *
+ * The dependencies are in CSR form: a job's numDeps say how many of the chunk's edges
+ * are its own. Chunks are self contained, so the file is read one chunk at a time -- in
+ * place when mmapped, or with one read() per chunk from a pipe -- and a chunk is checked
+ * (its numDeps must add up to its dependency count) before any of it is used.
+ *
+ * The reader knows nothing about the Scheduler. It only checks the format; a record
+ * whose values make no sense (e.g. a negative execTime) is for the caller to reject with
+ * report(). Every error is kept with its line (binary: record) number so the caller can
+ * show one summary at the end instead of interrupting the load at every bad record.
+ */
+
+#ifndef TRACEREADER_H_
+#define TRACEREADER_H_
+
+#include <vector>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+class TraceReader {
+	public:
+		//The binary format (see above)
+		static const char     MAGIC[8];
+		static const uint32_t VERSION = 1;
+		static const size_t   HEADER_SIZE = 32;
+		static const size_t   CHUNK_HEADER_SIZE = 8;
+		static const size_t   RECORD_SIZE = 16;
+
+		struct Record {
+			int line; //line of the file the record starts on, or record number if binary
+			int pid;
+			int execTime;
+			int resources;
+			std::vector<int> deps; //without the -1
+		};
+
+		struct Error {
+			int line;
+			std::string message;
+		};
+
+		 TraceReader();
+		~TraceReader();
+
+		//Map (or read) fileName, or stdin if fileName is NULL. Return false if it cannot
+		//be opened
+		bool open(const char *fileName);
+
+		//Parse text that is already in memory (not copied; it must outlive the reader)
+		void open_memory(const char *text, size_t size);
+
+		//Parse the next record into r. A record with a syntax error is reported and
+		//skipped up to the end of its line. Return false at the end of the input
+		bool next(Record &r);
+
+		void report(int line, std::string message); //add an error to the summary
+		std::vector<Error> &get_errors();
+		size_t get_size();  //bytes in the input (binary from a pipe: the current chunk)
+		bool   is_binary();
+
+	private:
+		const char *data;  //the whole input (binary from a pipe: the current chunk)
+		const char *end;
+		const char *pos;   //next byte to parse
+		size_t mapped;     //length of the mapping, or 0 if data is in buffer
+		std::vector<char> buffer;
+		int    line;       //line pos is on (binary: number of the last record read)
+		int    fd;		   //binary from a pipe: where the chunks come from, else -1
+
+		bool binary;
+		uint32_t chunkLeft; //binary: records left in the current chunk
+		const char *edges;  //binary: the next record's first dependency
+
+		std::vector<Error> errors;
+
+		void skip_space();
+		bool parse_int(int &value, int recordLine);
+		void skip_line();
+		void close();
+
+		bool next_binary(Record &r);
+		bool load_chunk();
+		size_t read_fully(char *dst, size_t n);
+};
+
+//Little endian integers for the binary format, whatever the host
+uint32_t trace_get32(const char *p);
+void     trace_put32(char *p, uint32_t v);
+
+#endif /* TRACEREADER_H_ */
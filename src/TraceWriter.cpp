@@ -0,0 +1,121 @@
+/*
+ * TraceWriter.cpp
+ * see TraceWriter.h for details
+ */
+
+#include <string.h>
+#include "TraceWriter.h"
+
+using namespace std;
+
+TraceWriter::TraceWriter() {
+	out    = NULL;
+	binary = false;
+	failed = false;
+	chunkJobs  = DEFAULT_CHUNK_JOBS;
+	totalJobs  = 0;
+	totalEdges = 0;
+}
+
+TraceWriter::~TraceWriter() {
+	close();
+}
+
+bool TraceWriter::open(const char *fileName, bool binary, uint32_t chunkJobs) {
+	close();
+
+	out = fileName == NULL ? stdout : fopen(fileName, "wb");
+	if (out == NULL) {return false;}
+
+	this->binary    = binary;
+	this->chunkJobs = chunkJobs == 0 ? DEFAULT_CHUNK_JOBS : chunkJobs;
+	failed     = false;
+	totalJobs  = 0;
+	totalEdges = 0;
+
+	if (binary) {
+		char header[TraceReader::HEADER_SIZE];
+
+		memset(header, 0, sizeof(header));
+		memcpy(header, TraceReader::MAGIC, sizeof(TraceReader::MAGIC));
+		trace_put32(header + 8,  TraceReader::VERSION);
+		trace_put32(header + 12, this->chunkJobs);
+		failed = fwrite(header, sizeof(header), 1, out) != 1;
+	}
+	return !failed;
+}
+
+bool TraceWriter::write(const TraceReader::Record &r) {
+	if (!binary) {
+		fprintf(out, "%d\t%d\t%d", r.pid, r.execTime, r.resources);
+		for (unsigned i = 0; i < r.deps.size(); i++) {
+			fprintf(out, "\t%d", r.deps[i]);
+		}
+		fputs("\t-1\n", out);
+		return !ferror(out);
+	}
+
+	size_t at = records.size();
+	records.resize(at + TraceReader::RECORD_SIZE);
+	trace_put32(&records[at],      r.pid);
+	trace_put32(&records[at + 4],  r.execTime);
+	trace_put32(&records[at + 8],  r.resources);
+	trace_put32(&records[at + 12], r.deps.size());
+
+	at = edges.size();
+	edges.resize(at + 4 * r.deps.size());
+	for (unsigned i = 0; i < r.deps.size(); i++) {
+		trace_put32(&edges[at + 4 * i], r.deps[i]);
+	}
+
+	totalJobs++;
+	totalEdges += r.deps.size();
+
+	if (records.size() / TraceReader::RECORD_SIZE == chunkJobs) {flush_chunk();}
+	return !failed;
+}
+
+bool TraceWriter::close() {
+	if (out == NULL) {return true;}
+
+	if (binary) {
+		flush_chunk();
+
+		//Fill in the totals if we can go back to the header
+		if (out != stdout && fseek(out, 16, SEEK_SET) == 0) {
+			char totals[16];
+
+			trace_put32(totals,      (uint32_t) totalJobs);
+			trace_put32(totals + 4,  (uint32_t) (totalJobs >> 32));
+			trace_put32(totals + 8,  (uint32_t) totalEdges);
+			trace_put32(totals + 12, (uint32_t) (totalEdges >> 32));
+			failed = failed || fwrite(totals, sizeof(totals), 1, out) != 1;
+		}
+	}
+
+	failed = failed || ferror(out);
+	if (out == stdout) {failed = fflush(out) != 0 || failed;}
+	else 			   {failed = fclose(out) != 0 || failed;}
+	out = NULL;
+
+	return !failed;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+void TraceWriter::flush_chunk() {
+	uint32_t jobs = records.size() / TraceReader::RECORD_SIZE;
+	char head[TraceReader::CHUNK_HEADER_SIZE];
+
+	if (jobs == 0) {return;}
+
+	trace_put32(head,     jobs);
+	trace_put32(head + 4, edges.size() / 4);
+
+	failed = failed || fwrite(head, sizeof(head), 1, out) != 1 ||
+			 fwrite(&records[0], records.size(), 1, out) != 1 ||
+			 (!edges.empty() && fwrite(&edges[0], edges.size(), 1, out) != 1);
+
+	records.clear();
+	edges.clear();
+}
@@ -0,0 +1,45 @@
+/*
+ * TraceWriter
+ *
+ * Writes records to a job file in either format TraceReader reads (see TraceReader.h for
+ * both). Text comes out tab separated like sample-datasets/. Binary records are
+ * collected into a chunk of up to chunkJobs jobs, which is written in one go when it
+ * fills up; close() writes the last chunk and, if the file can seek, fills in the totals
+ * in the header (otherwise, e.g. on a pipe, they stay 0: unknown).
+ */
+
+#ifndef TRACEWRITER_H_
+#define TRACEWRITER_H_
+
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+#include "TraceReader.h"
+
+class TraceWriter {
+	public:
+		static const uint32_t DEFAULT_CHUNK_JOBS = 65536;
+
+		 TraceWriter();
+		~TraceWriter();
+
+		//Create fileName (or use stdout if NULL). Return false if it cannot be written
+		bool open(const char *fileName, bool binary, uint32_t chunkJobs);
+		bool write(const TraceReader::Record &r);
+		bool close(); //false if anything could not be written
+
+	private:
+		FILE *out;
+		bool  binary;
+		bool  failed;
+		uint32_t chunkJobs;
+		uint64_t totalJobs;
+		uint64_t totalEdges;
+
+		std::vector<char> records; //the chunk being collected
+		std::vector<char> edges;
+
+		void flush_chunk();
+};
+
+#endif /* TRACEWRITER_H_ */
@@ -0,0 +1,84 @@
+/*
+ * WorkerPool.cpp
+ * see WorkerPool.h for details
+ */
+
+#include <chrono>
+#include "WorkerPool.h"
+
+using namespace std;
+
+//Start every worker; they sleep on their condition variable until dispatched to
+WorkerPool::WorkerPool(int numWorkers, unsigned long jiffieTime, Timeline *timeline) {
+	JIFFIE_TIME = jiffieTime;
+	this->timeline = timeline;
+	stopping    = false;
+
+	for (int i = 0; i < numWorkers; i++) {
+		Worker *w = new Worker;
+		w->hasWork = false;
+		workers.push_back(w);
+	}
+
+	//Only start the threads once the vector stops moving
+	for (unsigned i = 0; i < workers.size(); i++) {
+		workers[i]->thread = thread(&WorkerPool::work_loop, this, workers[i]);
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	stopping = true;
+	
+	//Taking each lock before notifying means no worker can miss the wake up between
+	//checking stopping and going to sleep
+	for (unsigned i = 0; i < workers.size(); i++) {
+		lock_guard<mutex> guard(workers[i]->lock);
+		workers[i]->wake.notify_one();
+	}
+
+	for (unsigned i = 0; i < workers.size(); i++) {
+		workers[i]->thread.join();
+		delete workers[i];
+	}
+}
+
+//Public methods//////////////////////////////////////////////////////////////////////////
+
+//Hand the slice to its core's worker. The worker is idle (see WorkerPool.h), so the
+//lock is never contended for longer than it takes the worker to wake up
+void WorkerPool::dispatch(const Slice &s) {
+	Worker *w = workers[s.core];
+
+	lock_guard<mutex> guard(w->lock);
+	w->work    = s;
+	w->hasWork = true;
+	w->wake.notify_one();
+}
+
+//Called by the Scheduler thread only (the single consumer of the completion queue)
+bool WorkerPool::collect(Slice &s) {
+	return completed.pop(s);
+}
+
+//Private methods/////////////////////////////////////////////////////////////////////////
+
+//"Process" each slice by sleeping for its length, then report it as finished
+void WorkerPool::work_loop(Worker *w) {
+	while (true) {
+		Slice s;
+		{
+			unique_lock<mutex> guard(w->lock);
+			while (!w->hasWork && !stopping) {
+				w->wake.wait(guard);
+			}
+			if (stopping) {return;}
+
+			s = w->work;
+			w->hasWork = false;
+		}
+
+		this_thread::sleep_for(chrono::microseconds(JIFFIE_TIME * s.length));
+		if (timeline != NULL) {timeline->record(s.trace);}
+		completed.push(s);
+	}
+}
@@ -0,0 +1,73 @@
+/*
+ * WorkerPool
+ *
+ * A fixed pool of worker threads, one per simulated core, that actually spends the
+ * wallclock time of a slice so several cores can be processing at once. The Scheduler
+ * thread keeps making MLFQ decisions (and handling the menu) while slices are in flight.
+ *
+ * The Scheduler thread is the only thread that ever touches a Job. dispatch() hands a
+ * worker a Slice; the worker sleeps for the slice's length in realtime and pushes the
+ * same Slice onto a lock-free completion queue. The Scheduler drains that queue with
+ * collect() between iterations of its loop and finishes the slice itself (completion,
+ * successors, demotion...), so no Job ever needs a lock.
+ *
+ * A worker only ever has one slice at a time: the Scheduler must not dispatch to a
+ * worker again until that worker's previous slice has been collected.
+ *
+ * Once it has slept, a worker records the slice's Timeline event (filled in by the
+ * Scheduler) into its own ring of the Timeline, if there is one.
+ */
+
+#ifndef WORKERPOOL_H_
+#define WORKERPOOL_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "Job.h"
+#include "MPSCQueue.h"
+#include "Timeline.h"
+
+class WorkerPool {
+	public:
+		//One slice of processing handed from the Scheduler to a worker and back
+		struct Slice {
+			int  core;	   //core (and worker) the slice runs on
+			Job *job;	   //opaque to the worker -- only the Scheduler dereferences it
+			int  priority; //priority the job was running at
+			int  length;   //jiffies allocated
+			Timeline::Event trace; //recorded by the worker once the slice has run
+		};
+
+		 WorkerPool(int numWorkers, unsigned long jiffieTime, Timeline *timeline);
+		~WorkerPool(); //stops and joins every worker; in-flight slices are dropped
+
+		void dispatch(const Slice &s); //wake up worker s.core to process s
+		bool collect(Slice &s);		   //pop a finished slice; false if none is ready
+
+	private:
+		struct Worker {
+			std::thread 			thread;
+			std::mutex 				lock;
+			std::condition_variable wake;
+			bool  					hasWork;
+			Slice 					work;
+		};
+
+		unsigned long JIFFIE_TIME; //microseconds of wallclock time per jiffie
+		Timeline 	 *timeline;	   //or NULL
+
+		std::vector<Worker*> workers;
+		MPSCQueue<Slice> 	 completed;
+		std::atomic<bool> 	 stopping;
+
+		void work_loop(Worker *w);
+
+		//Not copyable
+		WorkerPool(const WorkerPool &);
+		WorkerPool &operator=(const WorkerPool &);
+};
+
+#endif /* WORKERPOOL_H_ */
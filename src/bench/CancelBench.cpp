@@ -0,0 +1,122 @@
+/*
+ * CancelBench.cpp
+ *
+ * Benchmark of Scheduler::cancel() on subgraphs of JOBS jobs (default 10^5) downstream of
+ * one root, in three shapes:
+ *
+ *   chain    each job depends on the one before it (as deep as it gets)
+ *   fan-out  every job depends on the root alone (one successor list of JOBS)
+ *   layered  layers of 1000, each job depending on 3 random jobs of the layer above and
+ *            on a hub job outside the subgraph, which loses JOBS successors at once
+ *
+ * each with and without Chain Weighting Mode (which also shrinks the longest chains of
+ * the jobs left). Beside every subgraph are 1000 independent jobs that must survive: the
+ * jobs are loaded headless, the root is cancelled (timed), then the rest is run and
+ * checked to be exactly the jobs outside the subgraph.
+ *
+ * Usage: $ ./cancel_bench [JOBS]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <stdlib.h>
+#include "../Scheduler.h"
+#include "Workload.h"
+
+using namespace std;
+
+static const int LAYER      = 1000;
+static const int FAN_IN     = 3;
+static const int BYSTANDERS = 1000;
+
+//A job file: the root is PID 1, the subgraph 2 .. numJobs + 1, then the hub (layered
+//only) and the bystanders. Return how many jobs are outside the subgraph
+static int make_jobs(const string &shape, int numJobs, string &text) {
+	stringstream out;
+	int hub = numJobs + 2;
+
+	srand(1);
+	out << "1 10 1 -1\n";
+	if (shape == "layered") {out << hub << " 10 1 -1\n";}
+
+	for (int pid = 2; pid <= numJobs + 1; pid++) {
+		out << pid << " 10 1 ";
+		if (shape == "chain") {
+			out << pid - 1 << " ";
+		} else if (shape == "fan-out" || pid - 2 < LAYER) {
+			out << 1 << " ";
+		} else {
+			int layerStart = 2 + ((pid - 2) / LAYER - 1) * LAYER;
+			for (int i = 0; i < FAN_IN; i++) {out << layerStart + rand() % LAYER << " ";}
+		}
+		if (shape == "layered") {out << hub << " ";}
+		out << "-1\n";
+	}
+	for (int i = 1; i <= BYSTANDERS; i++) {out << hub + i << " 10 1 -1\n";}
+
+	text = out.str();
+	return BYSTANDERS + (shape == "layered" ? 1 : 0);
+}
+
+//The "jobs_completed" line of print_stats()
+static long jobs_completed(Scheduler *scheduler) {
+	stringstream stats;
+	string key;
+	long value = -1;
+
+	scheduler->print_stats(stats, false);
+	while (stats >> key) {
+		if (key == "jobs_completed:") {stats >> value;}
+	}
+	return value;
+}
+
+int main(int argc, char *argv[]) {
+	int numJobs = argc > 1 ? atoi(argv[1]) : 100000;
+	const char *shapes[] = {"chain", "fan-out", "layered"};
+
+	if (numJobs < 1) {
+		cerr << "Usage: $ " << argv[0] << " [JOBS]" << endl;
+		return 1;
+	}
+
+	cout << numJobs << " jobs downstream of the root" << endl;
+	for (int s = 0; s < 3; s++) {
+		for (int chains = 0; chains < 2; chains++) {
+			Scheduler *scheduler = new Scheduler(20, 4, false, chains, false, true, 1,
+												 false, AdmissionQueue::FIFO, -1);
+			TraceReader trace;
+			TraceReader empty;
+			string text;
+			int outside = make_jobs(shapes[s], numJobs, text);
+
+			trace.open_memory(text.data(), text.size());
+			scheduler->load_jobs(trace);
+
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			int cancelled = scheduler->cancel(1);
+			double time = seconds_since(start);
+
+			empty.open_memory("", 0);
+			scheduler->run_headless(empty);
+			long completed = jobs_completed(scheduler);
+			delete scheduler;
+
+			cout << "  " << left << setw(8) << shapes[s] << (chains ? "-c " : "   ")
+				 << right << fixed << setprecision(2) << setw(8) << time * 1e3 << " ms, "
+				 << setprecision(1) << setw(6) << time * 1e9 / cancelled << " ns/job"
+				 << endl;
+
+			if (cancelled != numJobs + 1 || completed != outside) {
+				cerr << "cancelled " << cancelled << " of " << numJobs + 1 << ", then "
+					 << completed << " of the " << outside << " other jobs completed"
+					 << endl;
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,189 @@
+/*
+ * HashTableBench.cpp
+ *
+ * Micro-benchmark of the JobHashTable against the chained table it replaced and
+ * std::unordered_map, at 10^3 up to 10^MAXEXP jobs (default 10^6; pass 7 for 10^7,
+ * which needs a couple of GB for the Job objects alone).
+ *
+ * For each size and each PID pattern (random, and strided by 1000 like the PIDs some
+ * submitters hand out) it times: inserting every job, finding every job, looking up as
+ * many PIDs that do not exist, and removing every job. Times are nanoseconds per
+ * operation.
+ *
+ * Usage: $ ./hashtable_bench [MAXEXP]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <unordered_map>
+#include <stdlib.h>
+#include "../Job.h"
+#include "../JobHashTable.h"
+
+using namespace std;
+
+//The chained table JobHashTable used to be (array of vectors, pid modulo capacity),
+//kept here only as a baseline
+class ChainedTable {
+	public:
+		ChainedTable() : capacity(100), size(0) {buckets = new vector<Job*>[capacity];}
+		~ChainedTable() {delete [] buckets;}
+
+		Job *find(int pid) {
+			vector<Job*> &b = buckets[pid % capacity];
+			for (unsigned i = 0; i < b.size(); i++) {
+				if (b[i]->get_pid() == pid) {return b[i];}
+			}
+			return NULL;
+		}
+
+		void insert(Job *j) {
+			buckets[j->get_pid() % capacity].push_back(j);
+			if ((double) ++size / capacity >= .8) {expand();}
+		}
+
+		bool remove(int pid) {
+			vector<Job*> &b = buckets[pid % capacity];
+			for (unsigned i = 0; i < b.size(); i++) {
+				if (b[i]->get_pid() == pid) {
+					swap(b[i], b.back());
+					b.pop_back();
+					size--;
+					return true;
+				}
+			}
+			return false;
+		}
+
+	private:
+		int capacity;
+		int size;
+		vector<Job*> *buckets;
+
+		void expand() {
+			vector<Job*> *old = buckets;
+			capacity *= 2;
+			buckets = new vector<Job*>[capacity];
+			for (int i = 0; i < capacity / 2; i++) {
+				for (unsigned j = 0; j < old[i].size(); j++) {
+					buckets[old[i][j]->get_pid() % capacity].push_back(old[i][j]);
+				}
+			}
+			delete [] old;
+		}
+};
+
+//Same interface for std::unordered_map
+class StdTable {
+	public:
+		Job *find(int pid) {
+			unordered_map<int, Job*>::iterator it = map.find(pid);
+			return it == map.end() ? NULL : it->second;
+		}
+		void insert(Job *j)  {map[j->get_pid()] = j;}
+		bool remove(int pid) {return map.erase(pid) > 0;}
+
+	private:
+		unordered_map<int, Job*> map;
+};
+
+static double nanos_since(chrono::steady_clock::time_point start, long ops) {
+	chrono::duration<double, nano> d = chrono::steady_clock::now() - start;
+	return d.count() / ops;
+}
+
+//Time every operation on one table type; prints one row
+template <typename Table>
+static void run(const string &name, vector<Job*> &jobs, vector<int> &missing) {
+	Table table;
+	long  n = jobs.size();
+	long  found = 0;
+	chrono::steady_clock::time_point start;
+
+	start = chrono::steady_clock::now();
+	for (long i = 0; i < n; i++) {table.insert(jobs[i]);}
+	double insert = nanos_since(start, n);
+
+	start = chrono::steady_clock::now();
+	for (long i = n - 1; i >= 0; i--) {found += table.find(jobs[i]->get_pid()) != NULL;}
+	double hit = nanos_since(start, n);
+
+	start = chrono::steady_clock::now();
+	for (long i = 0; i < n; i++) {found += table.find(missing[i]) != NULL;}
+	double miss = nanos_since(start, n);
+
+	start = chrono::steady_clock::now();
+	for (long i = 0; i < n; i++) {found += table.remove(jobs[i]->get_pid());}
+	double remove = nanos_since(start, n);
+
+	if (found != 2 * n) {
+		cerr << name << ": wrong number of jobs found (" << found << ")" << endl;
+		exit(1);
+	}
+
+	cout << "  " << left << setw(16) << name << right << fixed << setprecision(1)
+		 << setw(10) << insert << setw(10) << hit << setw(10) << miss
+		 << setw(10) << remove << endl;
+}
+
+int main(int argc, char *argv[]) {
+	int maxExp = argc > 1 ? atoi(argv[1]) : 6;
+	mt19937 rng(15);
+
+	for (int e = 3; e <= maxExp; e++) {
+		long n = 1;
+		for (int i = 0; i < e; i++) {n *= 10;}
+
+		//strided PIDs must stay below INT_MAX, so 10^7 jobs use a smaller stride
+		long stride = n * 1000 < 2000000000 ? 1000 : 2000000000 / n;
+
+		for (int strided = 0; strided <= 1; strided++) {
+			vector<Job*> jobs;
+			vector<int>  missing;
+
+			//PIDs: either 1001, 2001, 3001... or random and distinct. Every PID is odd,
+			//so PID + 1 is always a miss
+			for (long i = 0; i < n; i++) {
+				int pid = strided ? (int) ((i + 1) * stride) + 1
+								  : (int) (rng() % 1000000000) * 2 + 1;
+				jobs.push_back(new Job(pid));
+				missing.push_back(pid + 1);
+			}
+			if (!strided) { //random PIDs may repeat; keep the first of each
+				StdTable seen;
+				vector<Job*> unique;
+				for (long i = 0; i < n; i++) {
+					if (seen.find(jobs[i]->get_pid()) == NULL) {
+						seen.insert(jobs[i]);
+						unique.push_back(jobs[i]);
+					} else {
+						delete jobs[i];
+					}
+				}
+				jobs.swap(unique);
+				missing.resize(jobs.size());
+			}
+
+			cout << "n = " << jobs.size() << (strided ? " (PIDs strided by " +
+											  to_string(stride) + ")" : " (random PIDs)")
+				 << ", ns/op:" << endl << "  " << left << setw(16) << "table" << right
+				 << setw(10) << "insert" << setw(10) << "find" << setw(10) << "miss"
+				 << setw(10) << "remove" << endl;
+
+			//the chained table degenerates on strided PIDs past 10^5; skip it there
+			if (!strided || n <= 100000) {
+				run<ChainedTable>("chained (old)", jobs, missing);
+			}
+			run<JobHashTable>("robin hood", jobs, missing);
+			run<StdTable>("unordered_map", jobs, missing);
+
+			for (unsigned i = 0; i < jobs.size(); i++) {delete jobs[i];}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * PriorityBench.cpp
+ *
+ * Micro-benchmark of the cost of one scheduling decision (find the highest priority
+ * that is not empty, take its front job, push it back one level down like end_slice
+ * does) as the number of priorities grows, for the linear scan the Scheduler used to do
+ * and for the LevelBitmap it does now.
+ *
+ * Every run starts with JOBS jobs in the top priority and keeps going until they have
+ * all sunk to priority 0 and cycled there for a while, so most decisions are made with
+ * nearly every level above the jobs empty -- the common case for a long running batch.
+ * Times are nanoseconds per decision.
+ *
+ * Usage: $ ./priority_bench [JOBS]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <stdlib.h>
+#include "../Job.h"
+#include "../JobQueue.h"
+#include "../LevelBitmap.h"
+
+using namespace std;
+
+static const long DECISIONS = 2000000;
+
+//The old pick_from_core: walk down from the top until a queue is not empty
+struct LinearScan {
+	vector<JobQueue> runs;
+
+	LinearScan(int levels) : runs(levels) {}
+
+	int highest() {
+		int p = runs.size() - 1;
+		while (p >= 0 && runs[p].empty()) {p--;}
+		return p;
+	}
+	void push(int p, Job *j) {runs[p].push(j);}
+	void pop (int p)		 {runs[p].pop();}
+};
+
+//The new one: the same queues plus a bitmap of which are not empty
+struct Bitmap {
+	vector<JobQueue> runs;
+	LevelBitmap nonEmpty;
+
+	Bitmap(int levels) : runs(levels), nonEmpty(levels) {}
+
+	int highest() {return nonEmpty.highest();}
+	void push(int p, Job *j) {runs[p].push(j); nonEmpty.set(p);}
+	void pop (int p) {
+		runs[p].pop();
+		if (runs[p].empty()) {nonEmpty.clear(p);}
+	}
+};
+
+//Returns ns per decision; sum is folded into a checksum so nothing is optimized away
+template <typename Mlfq>
+static double run(int levels, vector<Job*> &jobs, long &sum) {
+	Mlfq mlfq(levels);
+
+	for (unsigned i = 0; i < jobs.size(); i++) {mlfq.push(levels - 1, jobs[i]);}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (long i = 0; i < DECISIONS; i++) {
+		int p = mlfq.highest();
+		Job *j = mlfq.runs[p].front();
+		mlfq.pop(p);
+		mlfq.push(p > 0 ? p - 1 : 0, j);
+		sum += p;
+	}
+	chrono::duration<double, nano> d = chrono::steady_clock::now() - start;
+
+	for (int p = 0; p < levels; p++) {
+		while (!mlfq.runs[p].empty()) {mlfq.pop(p);}
+	}
+
+	return d.count() / DECISIONS;
+}
+
+int main(int argc, char *argv[]) {
+	int numJobs = argc > 1 ? atoi(argv[1]) : 100;
+	vector<Job*> jobs;
+	long linearSum = 0;
+	long bitmapSum = 0;
+
+	for (int i = 0; i < numJobs; i++) {jobs.push_back(new Job(i + 1));}
+
+	cout << numJobs << " jobs, " << DECISIONS << " decisions, ns/decision:" << endl
+		 << setw(12) << "priorities" << setw(14) << "linear (old)" << setw(12) << "bitmap"
+		 << endl;
+
+	for (int levels = 4; levels <= LevelBitmap::MAX_LEVELS; levels *= 4) {
+		double linear = run<LinearScan>(levels, jobs, linearSum);
+		double bitmap = run<Bitmap>(levels, jobs, bitmapSum);
+
+		cout << setw(12) << levels << fixed << setprecision(1) << setw(14) << linear
+			 << setw(12) << bitmap << endl;
+	}
+
+	if (linearSum != bitmapSum) {
+		cerr << "the two picked different priorities" << endl;
+		return 1;
+	}
+
+	for (unsigned i = 0; i < jobs.size(); i++) {delete jobs[i];}
+	return 0;
+}
@@ -0,0 +1,254 @@
+/*
+ * SchedBench.cpp
+ *
+ * End to end benchmark of the Scheduler on a synthetic workload (see Workload.h): the
+ * same jobs are run headless in each mode (plain, -c, -q and -cq) with each number of
+ * queues, and for every run it reports
+ *
+ *   load      seconds to load the jobs from a binary job file (all arriving at once)
+ *   run       seconds from then until the last job completed
+ *   slices/s  scheduling decisions per second of run (slices, see print_stats())
+ *   rss       peak resident memory of the run beyond what was resident before it
+ *   and the statistics of update_stats(): throughput, average latency, response and
+ *   turnaround, and average turnaround and latency per burst
+ *
+ * With --rate the jobs are not loaded but submit()ted as they arrive on the virtual
+ * clock (run_headless_until() up to each arrival), so there is no load column and run
+ * includes making the jobs.
+ *
+ * With --journal every run also journals to a temporary file, committing every MS
+ * milliseconds (see Journal.h), so its cost on the slice loop shows in run and slices/s.
+ *
+ * With --boost every run moves all jobs back to the top priority every N jiffies (see
+ * Scheduler::boost_every()), which shows in latency and response under a steady --rate.
+ *
+ * With --chains work the chain weighted runs are in Critical Path Mode (-p, chains
+ * measured in jiffies of work) instead of -c; on a workload with --depth and --size
+ * spread the two can be compared run for run.
+ *
+ * Every run is in a child process of its own so its memory is measured alone.
+ *
+ * Usage: $ ./sched_bench [WORKLOAD OPTIONS] [--queues 4,8,16] [--cores N] [--journal MS]
+ *                        [--boost N] [--chains jobs|work]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "Workload.h"
+#include "../Scheduler.h"
+#include "../TraceWriter.h"
+
+using namespace std;
+
+static void usageAbort(string program) {
+	cerr << "Usage: $ " << program << " [WORKLOAD OPTIONS] [--queues 4,8,16] [--cores N]"
+		 << " [--journal MS] [--boost N]" << endl
+		 << "                [--chains jobs|work]" << endl
+		 << "WORKLOAD OPTIONS (and their defaults):" << endl
+		 << workload_options();
+	exit(1);
+}
+
+//A line of /proc/self/status (e.g. "VmHWM:"), in MB
+static double status_mb(const string &field) {
+	ifstream status("/proc/self/status");
+	string   key;
+	double   kb = 0;
+
+	while (status >> key) {
+		if (key == field) {status >> kb; break;}
+		status.ignore(256, '\n');
+	}
+	return kb / 1024;
+}
+
+//Every "name: value" line of print_stats()
+static map<string, double> stats_of(Scheduler *scheduler) {
+	stringstream out;
+	string key;
+	double value;
+	map<string, double> stats;
+
+	scheduler->print_stats(out, false);
+	while (out >> key >> value) {
+		stats[key.substr(0, key.size() - 1)] = value;
+	}
+	return stats;
+}
+
+//One run, in the child: print its row (all but the newline)
+static void run(const vector<Arrival> &arrivals, const string &traceFile, bool chains,
+				bool criticalPath, bool quanta, int queues, int cores, bool arriving,
+				int journalInterval, int boostInterval) {
+	//Forget the high water mark inherited from the parent, then count from here
+	ofstream("/proc/self/clear_refs") << "5" << endl;
+	double before = status_mb("VmRSS:");
+
+	Scheduler *scheduler = new Scheduler(20, queues, quanta, chains && !criticalPath,
+										 chains && criticalPath, true, cores, false,
+										 AdmissionQueue::FIFO, -1);
+	TraceReader trace;
+	TraceReader empty;
+	double loadTime = 0;
+	string journalFile = traceFile + ".journal";
+
+	empty.open_memory("", 0);
+	unlink(journalFile.c_str());
+	if (journalInterval >= 0 &&
+		scheduler->journal_to(journalFile.c_str(), journalInterval) != NULL) {
+		cerr << "Cannot journal to " << journalFile << endl;
+		_exit(1);
+	}
+	scheduler->boost_every(boostInterval);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	if (!arriving) {
+		trace.open(traceFile.c_str());
+		scheduler->load_jobs(trace);
+		loadTime = seconds_since(start);
+		start 	 = chrono::steady_clock::now();
+	} else {
+		for (unsigned i = 0; i < arrivals.size(); ) {
+			int time = arrivals[i].time;
+
+			scheduler->run_headless_until(time);
+			for (; i < arrivals.size() && arrivals[i].time == time; i++) {
+				const TraceReader::Record &r = arrivals[i].record;
+				scheduler->submit(r.pid, r.execTime, r.resources, r.deps);
+			}
+		}
+	}
+	scheduler->run_headless(empty);
+	double runTime = seconds_since(start);
+
+	map<string, double> s = stats_of(scheduler);
+	double rss = status_mb("VmHWM:") - before;
+	delete scheduler;
+	unlink(journalFile.c_str());
+
+	string mode = string(chains ? (criticalPath ? "p" : "c") : "") + (quanta ? "q" : "");
+	cout << setw(4) << (mode.empty() ? "-" : "-" + mode) << setw(7) << queues << fixed
+		 << setprecision(3);
+	if (arriving) {cout << setw(8) << "-";}
+	else 		  {cout << setw(8) << loadTime;}
+	cout << setw(8) << runTime
+		 << setprecision(2) << setw(10) << s["slices_processed"] / runTime / 1e6
+		 << setprecision(1) << setw(8) << rss
+		 << setprecision(4) << setw(11) << s["throughput"]
+		 << setprecision(0) << setw(11) << s["avg_latency"]
+		 << setw(11) << s["avg_response"]
+		 << setw(11) << s["avg_turnaround"]
+		 << setprecision(2) << ' ' << setw(10) << s["avg_turnaround_per_burst"]
+		 << ' ' << setw(9) << s["avg_latency_per_burst"];
+
+	if (s["jobs_completed"] != arrivals.size()) {
+		cout << "  (only " << (long) s["jobs_completed"] << " jobs completed)";
+	}
+	cout.flush();
+}
+
+int main(int argc, char *argv[]) {
+	WorkloadSpec spec;
+	vector<int>  queueCounts;
+	int cores = 1;
+	int journalInterval = -1; //no journal
+	int boostInterval 	= 0;  //no boost
+	bool criticalPath 	= false;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+
+		if (i + 1 >= argc) {
+			usageAbort(argv[0]);
+		} else if (arg == "--queues") {
+			stringstream list(argv[++i]);
+			int n;
+			while (list >> n) {
+				if (n < 1) {usageAbort(argv[0]);}
+				queueCounts.push_back(n);
+				list.ignore(1, ',');
+			}
+		} else if (arg == "--cores") {
+			if ((cores = atoi(argv[++i])) < 1) {usageAbort(argv[0]);}
+		} else if (arg == "--journal") {
+			if ((journalInterval = atoi(argv[++i])) < 0) {usageAbort(argv[0]);}
+		} else if (arg == "--boost") {
+			if ((boostInterval = atoi(argv[++i])) < 1) {usageAbort(argv[0]);}
+		} else if (arg == "--chains") {
+			string unit = argv[++i];
+			if (unit != "jobs" && unit != "work") {usageAbort(argv[0]);}
+			criticalPath = unit == "work";
+		} else if (!set_workload_option(spec, arg, argv[++i])) {
+			usageAbort(argv[0]);
+		}
+	}
+	if (queueCounts.empty()) {
+		queueCounts.push_back(4);
+		queueCounts.push_back(8);
+		queueCounts.push_back(16);
+	}
+
+	vector<Arrival> arrivals;
+	char traceFile[] = "/tmp/sched_bench_XXXXXX";
+	bool arriving = spec.rate > 0;
+
+	generate_workload(spec, arrivals);
+
+	//All at once: through a job file, like sharkbatch --headless FILE
+	int fd = mkstemp(traceFile);
+	if (fd < 0) {
+		cerr << "Cannot create a temporary file" << endl;
+		return 1;
+	}
+	close(fd);
+	if (!arriving) {
+		TraceWriter out;
+		out.open(traceFile, true, TraceWriter::DEFAULT_CHUNK_JOBS);
+		for (unsigned i = 0; i < arrivals.size(); i++) {out.write(arrivals[i].record);}
+		out.close();
+	}
+
+	cout << arrivals.size() << " jobs";
+	if (arriving) {cout << " arriving over " << arrivals.back().time << " jiffies";}
+	cout << ", " << cores << (cores == 1 ? " core" : " cores");
+	if (journalInterval >= 0) {
+		cout << ", journal committed every " << journalInterval << " ms";
+	}
+	if (boostInterval > 0) {
+		cout << ", boost every " << boostInterval << " jiffies";
+	}
+	cout << endl
+		 << "mode queues  load s   run s M slices/s  rss MB throughput    latency"
+		 << "   response turnaround turn/burst lat/burst" << endl;
+
+	for (int m = 0; m < 4; m++) {
+		for (unsigned q = 0; q < queueCounts.size(); q++) {
+			pid_t child = fork();
+
+			if (child == 0) {
+				run(arrivals, traceFile, m & 1, criticalPath, m & 2, queueCounts[q],
+					cores, arriving, journalInterval, boostInterval);
+				_exit(0);
+			}
+
+			int status;
+			waitpid(child, &status, 0);
+			if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+				cout << "  (run failed)";
+			}
+			cout << endl;
+		}
+	}
+
+	unlink(traceFile);
+	return 0;
+}
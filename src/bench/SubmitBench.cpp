@@ -0,0 +1,87 @@
+/*
+ * SubmitBench.cpp
+ *
+ * Benchmark of Scheduler::submit() from several producer threads at once: each of 1, 4
+ * and 16 producers submits its share of JOBS jobs (default 10^6; each job after a
+ * producer's first depends on the one before it) to a headless Scheduler as fast as it
+ * can. Submissions/sec is measured over the producers alone; the jobs are then drained
+ * into the MLFQ and run by run_headless(), which is timed separately and checked to have
+ * made every job.
+ *
+ * Usage: $ ./submit_bench [JOBS]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <stdlib.h>
+#include "../Scheduler.h"
+#include "Workload.h"
+
+using namespace std;
+
+//Submit pids first+1 .. first+count, each depending on the one before
+static void produce(Scheduler *scheduler, int first, int count) {
+	vector<int> none;
+	vector<int> previous(1);
+
+	for (int pid = first + 1; pid <= first + count; pid++) {
+		previous[0] = pid - 1;
+		scheduler->submit(pid, pid % 50 + 1, pid % 100, pid == first + 1 ? none : previous);
+	}
+}
+
+//The "jobs_completed" line of print_stats()
+static long jobs_completed(Scheduler *scheduler) {
+	stringstream stats;
+	string key;
+	long value = -1;
+
+	scheduler->print_stats(stats, false);
+	while (stats >> key) {
+		if (key == "jobs_completed:") {stats >> value;}
+	}
+	return value;
+}
+
+int main(int argc, char *argv[]) {
+	int numJobs = argc > 1 ? atoi(argv[1]) : 1000000;
+	int producers[] = {1, 4, 16};
+
+	for (unsigned p = 0; p < sizeof(producers) / sizeof(producers[0]); p++) {
+		Scheduler *scheduler = new Scheduler(20, 4, false, false, false, true, 1, false,
+											 AdmissionQueue::FIFO, -1);
+		int share = numJobs / producers[p];
+		vector<thread> threads;
+		TraceReader empty;
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int t = 0; t < producers[p]; t++) {
+			threads.push_back(thread(produce, scheduler, t * share, share));
+		}
+		for (unsigned t = 0; t < threads.size(); t++) {threads[t].join();}
+		double submitTime = seconds_since(start);
+
+		start = chrono::steady_clock::now();
+		empty.open_memory("", 0);
+		scheduler->run_headless(empty);
+		double runTime = seconds_since(start);
+
+		long made = jobs_completed(scheduler);
+		delete scheduler;
+
+		cout << setw(2) << producers[p] << " producers: " << fixed << setprecision(2)
+			 << setw(7) << share * producers[p] / submitTime / 1e6 << " M submits/s, "
+			 << "drained and run in " << setprecision(3) << runTime << " s" << endl;
+
+		if (made != (long) share * producers[p]) {
+			cerr << "only " << made << " of " << share * producers[p]
+				 << " jobs completed" << endl;
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * TimelineBench.cpp
+ *
+ * Micro-benchmark of Timeline recording: nanoseconds per record() with tracing off, and
+ * on from 1, 4 and 16 threads at once (each into its own ring, so with a core per
+ * thread the time per event should not grow with the threads). Each thread records
+ * EVENTS events (default 10^7) into rings of Timeline::DEFAULT_EVENTS; the time is the
+ * wallclock time over all the events recorded. Then the time to write one full ring out
+ * as a Chrome trace.
+ *
+ * Usage: $ ./timeline_bench [EVENTS]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <stdlib.h>
+#include <unistd.h>
+#include "../Timeline.h"
+#include "Workload.h"
+
+using namespace std;
+
+static void produce(Timeline *timeline, int core, long events) {
+	for (long i = 0; i < events; i++) {
+		timeline->record(Timeline::SLICE, i, core, i & 7, i, 20, 0);
+	}
+}
+
+//Nanoseconds per event with numThreads threads recording events each at once
+static double time_threads(bool enabled, int numThreads, long events) {
+	Timeline timeline(Timeline::DEFAULT_EVENTS);
+	vector<thread> threads;
+
+	timeline.enable(enabled);
+	produce(&timeline, 0, Timeline::DEFAULT_EVENTS); //make and fault in this ring
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int t = 1; t < numThreads; t++) {
+		threads.push_back(thread(produce, &timeline, t, events));
+	}
+	produce(&timeline, 0, events);
+	for (unsigned t = 0; t < threads.size(); t++) {threads[t].join();}
+
+	return seconds_since(start) * 1e9 / events / numThreads;
+}
+
+int main(int argc, char *argv[]) {
+	long events = argc > 1 ? atol(argv[1]) : 10000000;
+	int  threadCounts[] = {1, 4, 16};
+
+	if (events < 1) {
+		cerr << "Usage: $ " << argv[0] << " [EVENTS]" << endl;
+		return 1;
+	}
+
+	cout << events << " events per thread" << endl << fixed << setprecision(2)
+		 << "  off:              " << setw(6) << time_threads(false, 1, events)
+		 << " ns/event" << endl;
+	for (int i = 0; i < 3; i++) {
+		cout << "  on, " << setw(2) << threadCounts[i] << " thread"
+			 << (threadCounts[i] == 1 ? ": " : "s:") << "      "
+			 << setw(6) << time_threads(true, threadCounts[i], events) << " ns/event"
+			 << endl;
+	}
+
+	Timeline timeline(Timeline::DEFAULT_EVENTS);
+	char name[] = "/tmp/timeline_bench_XXXXXX";
+	int  fd = mkstemp(name);
+
+	if (fd < 0) {
+		cerr << "Cannot create a temporary file" << endl;
+		return 1;
+	}
+	::close(fd);
+
+	timeline.enable(true);
+	produce(&timeline, 0, Timeline::DEFAULT_EVENTS);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	bool written = timeline.write_json(name, 1);
+	double time = seconds_since(start);
+	unlink(name);
+
+	if (!written) {
+		cerr << "Cannot write " << name << endl;
+		return 1;
+	}
+	cout << "  write_json:       " << setw(6) << time * 1e9 / Timeline::DEFAULT_EVENTS
+		 << " ns/event (" << Timeline::DEFAULT_EVENTS << " events)" << endl;
+	return 0;
+}
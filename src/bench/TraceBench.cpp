@@ -0,0 +1,142 @@
+/*
+ * TraceBench.cpp
+ *
+ * Micro-benchmark of parsing a trace file: the mmapped TraceReader against the ifstream
+ * >> loop the Scheduler used to read files with, and TraceReader on the same trace
+ * converted to the binary format. Only reading is timed -- no jobs are made -- and each
+ * sums every integer so they can be checked against each other.
+ *
+ * Without FILE a trace of JOBS random jobs (default 10^6, a few dependencies each, tab
+ * separated like sample-datasets/) is written to a temporary file first.
+ *
+ * Usage: $ ./trace_bench [FILE | -n JOBS]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <random>
+#include <chrono>
+#include <stdlib.h>
+#include <unistd.h>
+#include "../TraceReader.h"
+#include "../TraceWriter.h"
+#include "Workload.h"
+
+using namespace std;
+
+static string temporary_file() {
+	char name[] = "/tmp/trace_bench_XXXXXX";
+	int  fd = mkstemp(name);
+
+	if (fd < 0) {
+		cerr << "Cannot create a temporary file" << endl;
+		exit(1);
+	}
+	::close(fd);
+	return name;
+}
+
+//Time reading every record of fileName with a TraceReader; adds every integer to sum
+static double time_reader(const string &fileName, long long &sum, long &records,
+						  double &mb) {
+	TraceReader::Record r;
+	TraceReader trace;
+
+	if (!trace.open(fileName.c_str())) {
+		cerr << "File not found: " << fileName << endl;
+		exit(1);
+	}
+	mb = trace.get_size() / 1e6;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	while (trace.next(r)) {
+		sum += r.pid + r.execTime + r.resources - 1;
+		for (unsigned i = 0; i < r.deps.size(); i++) {sum += r.deps[i];}
+		records++;
+	}
+	double time = seconds_since(start);
+
+	if (!trace.get_errors().empty()) {
+		cerr << fileName << ": errors while reading" << endl;
+		exit(1);
+	}
+	return time;
+}
+
+static string make_trace(long numJobs) {
+	string  name = temporary_file();
+	mt19937 rng(15);
+
+	ofstream out(name.c_str());
+	for (long pid = 1; pid <= numJobs; pid++) {
+		out << pid << '\t' << rng() % 100000 + 1 << '\t' << rng() % 1000;
+		for (int d = rng() % 4; d > 0 && pid > 1; d--) {
+			out << '\t' << rng() % (pid - 1) + 1;
+		}
+		out << "\t-1\n";
+	}
+	return name;
+}
+
+int main(int argc, char *argv[]) {
+	string fileName;
+	bool   temporary = true;
+	long   numJobs = 1000000;
+
+	if (argc > 2 && string(argv[1]) == "-n") {
+		numJobs = atol(argv[2]);
+	} else if (argc > 1) {
+		fileName  = argv[1];
+		temporary = false;
+	}
+	if (temporary) {fileName = make_trace(numJobs);}
+
+	chrono::steady_clock::time_point start;
+	long long readerSum = 0;
+	long long streamSum = 0;
+	long long binarySum = 0;
+	long records = 0;
+	long binaryRecords = 0;
+	double mb, binaryMb;
+
+	double readerTime = time_reader(fileName, readerSum, records, mb);
+
+	//the same trace in binary
+	string binaryName = temporary_file();
+	TraceReader text;
+	TraceWriter binary;
+	TraceReader::Record r;
+
+	text.open(fileName.c_str());
+	binary.open(binaryName.c_str(), true, TraceWriter::DEFAULT_CHUNK_JOBS);
+	while (text.next(r)) {binary.write(r);}
+	binary.close();
+
+	double binaryTime = time_reader(binaryName, binarySum, binaryRecords, binaryMb);
+	unlink(binaryName.c_str());
+
+	start = chrono::steady_clock::now();
+	ifstream in(fileName.c_str());
+	int n;
+	while (in >> n) {streamSum += n;}
+	double streamTime = seconds_since(start);
+
+	if (temporary) {unlink(fileName.c_str());}
+
+	cout << records << " records, " << fixed << setprecision(1) << mb << " MB as text, "
+		 << binaryMb << " MB as binary" << endl
+		 << "  TraceReader, text:   " << setw(8) << mb / readerTime << " MB/s, "
+		 << setw(8) << records / readerTime / 1e6 << " M records/s" << endl
+		 << "  TraceReader, binary: " << setw(8) << binaryMb / binaryTime << " MB/s, "
+		 << setw(8) << records / binaryTime / 1e6 << " M records/s" << endl
+		 << "  ifstream >> (old):   " << setw(8) << mb / streamTime << " MB/s, "
+		 << setw(8) << records / streamTime / 1e6 << " M records/s" << endl;
+
+	if (readerSum != streamSum || binarySum != readerSum || binaryRecords != records) {
+		cerr << "the readers parsed different integers" << endl;
+		return 1;
+	}
+	return 0;
+}
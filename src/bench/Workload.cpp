@@ -0,0 +1,106 @@
+/*
+ * Workload.cpp
+ * see Workload.h for details
+ */
+
+#include <random>
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include "Workload.h"
+
+using namespace std;
+
+WorkloadSpec::WorkloadSpec() {
+	jobs	   = 100000;
+	rate	   = 0;
+	burstMin   = 5;
+	burstMax   = 100000;
+	burstAlpha = 1.5;
+	memMean	   = 50;
+	memMax	   = 1000;
+	depth	   = 1;
+	width	   = 100;
+	fanIn	   = 2;
+	seed	   = 1;
+}
+
+void generate_workload(const WorkloadSpec &spec, vector<Arrival> &arrivals) {
+	mt19937_64 rng(spec.seed);
+	uniform_real_distribution<double> uniform(0, 1);
+	exponential_distribution<double>  gap(spec.rate > 0 ? spec.rate : 1);
+	double clock = 0;
+	long   dagJobs = (long) spec.depth * spec.width;
+	int    fanIn = min(spec.fanIn, spec.width);
+	Arrival a;
+
+	arrivals.reserve(arrivals.size() + spec.jobs);
+
+	for (long i = 0; i < spec.jobs; i++) {
+		if (spec.rate > 0) {clock += gap(rng);}
+
+		double burst  = spec.burstMin / pow(1 - uniform(rng), 1 / spec.burstAlpha);
+		double memory = spec.memMean == 0 ? 0 : -log(1 - uniform(rng)) * spec.memMean;
+
+		a.time 			   = (int) clock;
+		a.record.line	   = i + 1;
+		a.record.pid	   = i + 1;
+		a.record.execTime  = burst < spec.burstMax ? (int) burst : spec.burstMax;
+		a.record.resources = memory < spec.memMax ? (int) memory : spec.memMax;
+		a.record.deps.clear();
+
+		//fanIn different jobs of the layer above, if there is one
+		long layerStart = i - i % dagJobs + (i % dagJobs) / spec.width * spec.width;
+		if (i % dagJobs >= spec.width) {
+			while ((int) a.record.deps.size() < fanIn) {
+				int pid = layerStart - spec.width + rng() % spec.width + 1;
+
+				if (find(a.record.deps.begin(), a.record.deps.end(), pid) ==
+					a.record.deps.end()) {
+					a.record.deps.push_back(pid);
+				}
+			}
+		}
+		arrivals.push_back(a);
+	}
+}
+
+bool set_workload_option(WorkloadSpec &spec, const string &option, const char *value) {
+	char  *end;
+	double x = strtod(value, &end);
+
+	if (*value == '\0' || *end != '\0') {return false;}
+
+	if 		(option == "--jobs") 		{spec.jobs		 = (long) x; return x >= 1;}
+	else if (option == "--rate") 		{spec.rate		 = x; 		 return x >= 0;}
+	else if (option == "--burst-min") 	{spec.burstMin	 = (int) x;  return x >= 1;}
+	else if (option == "--burst-max") 	{spec.burstMax	 = (int) x;  return x >= 1;}
+	else if (option == "--burst-alpha") {spec.burstAlpha = x; 		 return x > 0;}
+	else if (option == "--mem-mean") 	{spec.memMean	 = (int) x;  return x >= 0;}
+	else if (option == "--mem-max") 	{spec.memMax	 = (int) x;  return x >= 0;}
+	else if (option == "--depth") 		{spec.depth		 = (int) x;  return x >= 1;}
+	else if (option == "--width") 		{spec.width		 = (int) x;  return x >= 1;}
+	else if (option == "--fan-in") 		{spec.fanIn		 = (int) x;  return x >= 0;}
+	else if (option == "--seed") 		{spec.seed		 = (unsigned) x; return true;}
+
+	return false;
+}
+
+double seconds_since(chrono::steady_clock::time_point start) {
+	chrono::duration<double> d = chrono::steady_clock::now() - start;
+	return d.count();
+}
+
+const char *workload_options() {
+	return "  --jobs N          jobs to make (100000)\n"
+		   "  --rate R          Poisson arrivals per jiffy, 0 for all at once (0)\n"
+		   "  --burst-min B     Pareto burst times: minimum (5),\n"
+		   "  --burst-alpha A   shape, the smaller the heavier the tail (1.5),\n"
+		   "  --burst-max B     and cut-off (100000)\n"
+		   "  --mem-mean M      exponential memory demand: mean (50)\n"
+		   "  --mem-max M       and cut-off (1000)\n"
+		   "  --depth D         layered DAGs: layers per DAG, 1 for no dependencies (1),\n"
+		   "  --width W         jobs per layer (100),\n"
+		   "  --fan-in F        and dependencies per job on the layer above (2)\n"
+		   "  --seed S          random seed (1)\n";
+}
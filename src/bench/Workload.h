@@ -0,0 +1,66 @@
+/*
+ * Workload
+ *
+ * Synthetic job traces for the benchmarks, shaped like real batch load rather than
+ * uniform noise:
+ *
+ * ARRIVALS are a Poisson process: the gaps between jobs are exponential with mean
+ * 1 / rate jiffies. With a rate of 0 every job arrives at time 0, like a loaded file.
+ *
+ * BURSTS (execution times) are Pareto distributed, minimum burstMin and shape
+ * burstAlpha, so most jobs are short and a few are very long; the smaller the shape the
+ * heavier the tail (below 2 the variance is infinite). Cut off at burstMax.
+ *
+ * MEMORY demand is exponential with mean memMean, cut off at memMax.
+ *
+ * DEPENDENCIES come as random layered DAGs, one after another: each is depth layers of
+ * width jobs, and every job below the top layer depends on fanIn different jobs of the
+ * layer above it (all of them if the layer is narrower). A depth of 1 gives independent
+ * jobs. PIDs count up from 1 in arrival order, so a job arrives after its dependencies.
+ *
+ * Also the odds and ends the benchmarks share, such as timing.
+ */
+
+#ifndef WORKLOAD_H_
+#define WORKLOAD_H_
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include "../TraceReader.h"
+
+struct WorkloadSpec {
+	long   jobs;
+	double rate;	   //arrivals per jiffy, 0 for all at once
+	int    burstMin;
+	int    burstMax;
+	double burstAlpha;
+	int    memMean;
+	int    memMax;
+	int    depth;	   //layers per DAG
+	int    width;	   //jobs per layer
+	int    fanIn;	   //dependencies per job below the top layer
+	unsigned seed;
+
+	WorkloadSpec(); //the defaults printed by workload_gen's usage
+};
+
+struct Arrival {
+	int time; //jiffy the job arrives at
+	TraceReader::Record record;
+};
+
+//Append spec.jobs arrivals, in order of time, to arrivals
+void generate_workload(const WorkloadSpec &spec, std::vector<Arrival> &arrivals);
+
+//Set the field of spec named by option (e.g. "--rate") to value. Return false if there
+//is no such option or the value is out of range
+bool set_workload_option(WorkloadSpec &spec, const std::string &option, const char *value);
+
+//A line per option with its default, for a usage message
+const char *workload_options();
+
+//Wallclock seconds from start until now
+double seconds_since(std::chrono::steady_clock::time_point start);
+
+#endif /* WORKLOAD_H_ */
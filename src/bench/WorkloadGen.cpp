@@ -0,0 +1,70 @@
+/*
+ * WorkloadGen.cpp
+ *
+ * workload_gen: writes a synthetic job file (see Workload.h for the distributions) that
+ * sharkbatch, sharkbatch-convert and the benchmarks all read. Job files have no arrival
+ * times, so with --rate the jobs are only written in the order they arrive (sched_bench
+ * plays the arrivals out itself); the time span they cover is printed.
+ *
+ * Usage: $ ./workload_gen [OPTIONS] [--binary] OUT   (OUT may be - for stdout)
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include "Workload.h"
+#include "../TraceWriter.h"
+
+using namespace std;
+
+static void usageAbort(string program) {
+	cerr << "Usage: $ " << program << " [OPTIONS] [--binary] OUT" << endl
+		 << "Writes a synthetic job file (text unless --binary) to OUT, or to stdout if"
+		 << endl << "OUT is -. OPTIONS (and their defaults):" << endl
+		 << workload_options();
+	exit(1);
+}
+
+int main(int argc, char *argv[]) {
+	WorkloadSpec spec;
+	bool   binary = false;
+	string outFile;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+
+		if (arg == "--binary") {
+			binary = true;
+		} else if (arg == "-" || arg[0] != '-') {
+			if (!outFile.empty()) {usageAbort(argv[0]);}
+			outFile = arg;
+		} else if (i + 1 >= argc || !set_workload_option(spec, arg, argv[++i])) {
+			usageAbort(argv[0]);
+		}
+	}
+	if (outFile.empty()) {usageAbort(argv[0]);}
+
+	vector<Arrival> arrivals;
+	TraceWriter out;
+
+	generate_workload(spec, arrivals);
+
+	if (!out.open(outFile == "-" ? NULL : outFile.c_str(), binary,
+				  TraceWriter::DEFAULT_CHUNK_JOBS)) {
+		cerr << "Cannot write to: " << outFile << endl;
+		return 1;
+	}
+	for (unsigned i = 0; i < arrivals.size(); i++) {
+		if (!out.write(arrivals[i].record)) {break;}
+	}
+	if (!out.close()) {
+		cerr << "Cannot write to: " << outFile << endl;
+		return 1;
+	}
+
+	cerr << arrivals.size() << " jobs written as " << (binary ? "binary" : "text");
+	if (spec.rate > 0) {cerr << ", arriving over " << arrivals.back().time << " jiffies";}
+	cerr << endl;
+	return 0;
+}
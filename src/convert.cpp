@@ -0,0 +1,87 @@
+/*
+ * convert.cpp
+ *
+ * sharkbatch-convert: turns a text job file (the sample-datasets/ format) into a binary
+ * one and back (see TraceReader.h for both formats). The input format is detected; the
+ * output is the other one unless --to says otherwise.
+ *
+ * Usage: $ ./sharkbatch-convert [--to text|binary] [--chunk JOBS] IN OUT
+ *		  (IN and OUT may be - for stdin and stdout)
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include "TraceReader.h"
+#include "TraceWriter.h"
+
+using namespace std;
+
+static void usageAbort(string program) {
+	cerr << "Usage: $ " << program << " [--to text|binary] [--chunk JOBS] IN OUT" << endl
+		 << "Converts a job file between the text and binary formats; by default to"  << endl
+		 << "the one IN is not in. IN and OUT may be - for stdin and stdout. --chunk"  << endl
+		 << "sets the jobs per chunk of a binary file (default "
+		 << TraceWriter::DEFAULT_CHUNK_JOBS << ")" << endl;
+	exit(1);
+}
+
+int main(int argc, char *argv[]) {
+	string to;
+	long   chunkJobs = TraceWriter::DEFAULT_CHUNK_JOBS;
+	vector<string> files;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+
+		if (arg == "--to" && i + 1 < argc) {
+			to = argv[++i];
+			if (to != "text" && to != "binary") {usageAbort(argv[0]);}
+		} else if (arg == "--chunk" && i + 1 < argc) {
+			if ((chunkJobs = atol(argv[++i])) < 1) {usageAbort(argv[0]);}
+		} else if (arg == "-" || arg[0] != '-') {
+			files.push_back(arg);
+		} else {
+			usageAbort(argv[0]);
+		}
+	}
+	if (files.size() != 2) {usageAbort(argv[0]);}
+
+	TraceReader in;
+	TraceWriter out;
+	TraceReader::Record r;
+	long records = 0;
+
+	if (!in.open(files[0] == "-" ? NULL : files[0].c_str())) {
+		cerr << "File not found: " << files[0] << endl;
+		return 1;
+	}
+
+	bool binary = to.empty() ? !in.is_binary() : to == "binary";
+
+	if (!out.open(files[1] == "-" ? NULL : files[1].c_str(), binary, chunkJobs)) {
+		cerr << "Cannot write to: " << files[1] << endl;
+		return 1;
+	}
+
+	while (in.next(r)) {
+		if (!out.write(r)) {break;}
+		records++;
+	}
+
+	bool written = out.close();
+	vector<TraceReader::Error> &errors = in.get_errors();
+
+	for (unsigned i = 0; i < errors.size(); i++) {
+		cerr << files[0] << ": " << (in.is_binary() ? "record " : "line ")
+			 << errors[i].line << ": " << errors[i].message << " (skipped)" << endl;
+	}
+	if (!written) {
+		cerr << "Cannot write to: " << files[1] << endl;
+		return 1;
+	}
+
+	cerr << records << " jobs written as " << (binary ? "binary" : "text") << endl;
+	return errors.empty() ? 0 : 1;
+}
@@ -6,24 +6,123 @@
  */
 
 #include <iostream>
+#include <fstream>
 #include <string>
+#include <vector>
 #include <stdlib.h>
 #include "Scheduler.h"
 
 using namespace std;
 
+//Long options that are not passed to the Scheduler constructor
+struct RunOptions {
+	bool   headless;  //--headless: no NCurses, virtual clock, exit when done
+	bool   parallel;  //--parallel: process slices on one worker thread per core
+	string traceFile; //--trace FILE: jobs to load in headless mode (default stdin)
+	string jsonFile;  //--json FILE: write statistics as JSON instead of to stdout
+	string followFile; //--follow FILE: FIFO or append-only file to ingest jobs from
+	AdmissionQueue::Policy admitPolicy; //--admit POLICY: see AdmissionQueue.h
+	int    maxBypass; //--reserve N: the head job can be bypassed N times (default never)
+	int    boostEvery; //--boost N: every job back to the top priority every N jiffies
+	string restoreFile;	   //--restore FILE: start from this checkpoint
+	string checkpointFile; //--checkpoint FILE: where checkpoints go
+	int    checkpointEvery; //--checkpoint-every N: ...every N jiffies (default on demand)
+	string journalFile;	   //--journal FILE: replay, then append to this journal
+	int    journalInterval; //--journal-interval MS: between group commits (default 10)
+	string histogramFile;  //--histograms FILE: export the histograms here when done
+	string timelineFile;   //--timeline FILE: trace events, write them here when done
+};
+
 //Functions helping main
-Scheduler *command_line_scheduler_creator(int argc, char *argv[]);
+Scheduler *command_line_scheduler_creator(int argc, char *argv[], RunOptions &opts);
+int  run_headless(Scheduler *sharkBatch, RunOptions &opts);
 void usageAbort(string program);
 
-//Main creates a Scheduler, calls run(), then deletes the Scheduler.
+//Main creates a Scheduler, calls run() (or run_headless()), then deletes the Scheduler.
 int main(int argc, char *argv[]) {
-	Scheduler *sharkBatch = command_line_scheduler_creator(argc, argv);
+	RunOptions opts;
+	int status = 0;
+	Scheduler *sharkBatch = command_line_scheduler_creator(argc, argv, opts);
+	const char *error = NULL;
+	
+	if (!opts.restoreFile.empty() &&
+		(error = sharkBatch->restore(opts.restoreFile.c_str())) != NULL) {
+		delete sharkBatch; //before printing, so NCurses has given the terminal back
+		cerr << "Cannot restore " << opts.restoreFile << ": " << error << endl;
+		return 1;
+	}
+	if (!opts.journalFile.empty() &&
+		(error = sharkBatch->journal_to(opts.journalFile.c_str(),
+										opts.journalInterval)) != NULL) {
+		delete sharkBatch;
+		cerr << "Cannot journal to " << opts.journalFile << ": " << error << endl;
+		return 1;
+	}
+	if (opts.boostEvery > 0) {
+		sharkBatch->boost_every(opts.boostEvery);
+	}
+	if (!opts.checkpointFile.empty()) {
+		sharkBatch->checkpoint_every(opts.checkpointFile.c_str(), opts.checkpointEvery);
+	}
+	if (!opts.histogramFile.empty()) {
+		sharkBatch->histograms_to(opts.histogramFile.c_str());
+	}
+	if (!opts.timelineFile.empty()) {
+		sharkBatch->timeline_to(opts.timelineFile.c_str());
+	}
+	
+	if (opts.headless) {
+		status = run_headless(sharkBatch, opts);
+	} else if (!opts.followFile.empty() && !sharkBatch->follow(opts.followFile.c_str())) {
+		delete sharkBatch; //before printing, so NCurses has given the terminal back
+		cerr << "Cannot open: " << opts.followFile << endl;
+		return 1;
+	} else {
+		sharkBatch->run();
+	}
 	
-	sharkBatch->run();
+	const char *traceError = NULL;
 	
+	if (!opts.histogramFile.empty()) {
+		error = sharkBatch->export_histograms(opts.histogramFile.c_str());
+	}
+	if (!opts.timelineFile.empty()) {
+		traceError = sharkBatch->export_timeline(opts.timelineFile.c_str());
+	}
 	delete sharkBatch;
 	
+	if (error != NULL) 	    {cerr << error << ": " << opts.histogramFile << endl;}
+	if (traceError != NULL) {cerr << traceError << ": " << opts.timelineFile << endl;}
+	if (error != NULL || traceError != NULL) {status = 1;}
+	
+	return status;
+}
+
+//Open the trace (or use stdin, unless restoring from a checkpoint), run it to
+//completion, and print the statistics either to stdout or to the JSON file
+int run_headless(Scheduler *sharkBatch, RunOptions &opts) {
+	TraceReader trace;
+	
+	if (opts.traceFile.empty() && !opts.restoreFile.empty()) {
+		trace.open_memory("", 0);
+	} else if (!trace.open(opts.traceFile.empty() ? NULL : opts.traceFile.c_str())) {
+		cerr << "File not found: " << opts.traceFile << endl;
+		return 1;
+	}
+	
+	sharkBatch->run_headless(trace);
+	
+	if (opts.jsonFile.empty()) {
+		sharkBatch->print_stats(cout, false);
+	} else {
+		ofstream outFile(opts.jsonFile.c_str());
+		if (outFile.fail()) {
+			cerr << "Cannot write to: " << opts.jsonFile << endl;
+			return 1;
+		}
+		sharkBatch->print_stats(outFile, true);
+	}
+	
 	return 0;
 }
 
@@ -32,52 +131,158 @@ int main(int argc, char *argv[]) {
 //Given the argc and argv, interpret the command line arguments and allocate a new
 //Scheduler object based on the parameters. Notably, we need in total the two boolean
 //flags and the two integers required by the Scheduler constructor (see Scheduler.cpp for
-//more details)
-Scheduler *command_line_scheduler_creator(int argc, char *argv[]) {
+//more details). Long "--" options may appear anywhere and are recorded in opts
+Scheduler *command_line_scheduler_creator(int argc, char *argv[], RunOptions &opts) {
 	bool chainWeighting = false; //CL flags
+	bool criticalPath = false;
 	bool varyQuanta = false;
+	int  numCores = 1;
+	vector<char *> numbers; //BASE and QUEUENUM
 	
-	cerr << argc;
+	opts.headless    = false;
+	opts.parallel    = false;
+	opts.admitPolicy = AdmissionQueue::FIFO;
+	opts.maxBypass   = -1;
+	opts.boostEvery  = 0;
+	opts.checkpointEvery = 0;
+	opts.journalInterval = 10;
 	
-	if (argc < 3) { //We need the arguments... there is no default
-		usageAbort(argv[0]);
-	}
-
-	if (argc >= 1 && argv[1][0] == '-') { //Check if a hyphenated flag specifier exists
-		if (argc != 4) { //If there are flags we need to check there are more arguments
-			usageAbort(argv[0]);
-		}
-		for (int j = 1; argv[1][j] != '\0'; j++) { //interpret the flags
-			switch (argv[1][j]) {
-				case 'c':
-					chainWeighting = true;
-					break;
-				case 'q':
-					varyQuanta = true;
-					break;
-				default:
-					usageAbort(argv[0]);
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		
+		if (arg == "--headless") {
+			opts.headless = true;
+		} else if (arg == "--parallel") {
+			opts.parallel = true;
+		} else if (arg == "--trace" && i + 1 < argc) {
+			opts.traceFile = argv[++i];
+		} else if (arg == "--json" && i + 1 < argc) {
+			opts.jsonFile = argv[++i];
+		} else if (arg == "--follow" && i + 1 < argc) {
+			opts.followFile = argv[++i];
+		} else if (arg == "--admit" && i + 1 < argc) {
+			string policy = argv[++i];
+			
+			if 		(policy == "fifo") 		{opts.admitPolicy = AdmissionQueue::FIFO;}
+			else if (policy == "first-fit") {opts.admitPolicy = AdmissionQueue::FIRST_FIT;}
+			else if (policy == "best-fit")  {opts.admitPolicy = AdmissionQueue::BEST_FIT;}
+			else 							{usageAbort(argv[0]);}
+		} else if (arg == "--restore" && i + 1 < argc) {
+			opts.restoreFile = argv[++i];
+		} else if (arg == "--checkpoint" && i + 1 < argc) {
+			opts.checkpointFile = argv[++i];
+		} else if (arg == "--checkpoint-every" && i + 1 < argc) {
+			if ((opts.checkpointEvery = atoi(argv[++i])) < 1) {
+				usageAbort(argv[0]);
 			}
+		} else if (arg == "--histograms" && i + 1 < argc) {
+			opts.histogramFile = argv[++i];
+		} else if (arg == "--timeline" && i + 1 < argc) {
+			opts.timelineFile = argv[++i];
+		} else if (arg == "--journal" && i + 1 < argc) {
+			opts.journalFile = argv[++i];
+		} else if (arg == "--journal-interval" && i + 1 < argc) {
+			if ((opts.journalInterval = atoi(argv[++i])) < 0) {
+				usageAbort(argv[0]);
+			}
+		} else if (arg == "--boost" && i + 1 < argc) {
+			if ((opts.boostEvery = atoi(argv[++i])) < 1) {
+				usageAbort(argv[0]);
+			}
+		} else if (arg == "--reserve" && i + 1 < argc) {
+			if ((opts.maxBypass = atoi(argv[++i])) < 0) {
+				usageAbort(argv[0]);
+			}
+		} else if (arg.size() > 1 && arg[0] == '-' && arg[1] != '-') {
+			for (unsigned j = 1; j < arg.size(); j++) { //interpret the flags
+				switch (arg[j]) {
+					case 'c':
+						chainWeighting = true;
+						break;
+					case 'p':
+						criticalPath = true;
+						break;
+					case 'q':
+						varyQuanta = true;
+						break;
+					case 'n': //the only flag that takes a value: the next argument
+						if (i + 1 >= argc || (numCores = atoi(argv[++i])) < 1) {
+							usageAbort(argv[0]);
+						}
+						break;
+					default:
+						usageAbort(argv[0]);
+				}
+			}
+		} else if (arg[0] != '-') {
+			numbers.push_back(argv[i]);
+		} else {
+			usageAbort(argv[0]);
 		}
-
+	}
+	
+	if (numbers.size() != 2 || (opts.parallel && opts.headless) ||
+		(!opts.followFile.empty() && opts.headless) ||
+		(opts.checkpointEvery > 0 && opts.checkpointFile.empty())) {
+		usageAbort(argv[0]);
 	}
 	
 	//Create a new Scheduler and return a pointer to it
-	return new Scheduler(atoi(argv[argc - 2]), atoi(argv[argc - 1]),
-						 varyQuanta, chainWeighting);
+	return new Scheduler(atoi(numbers[0]), atoi(numbers[1]),
+						 varyQuanta, chainWeighting, criticalPath, opts.headless,
+						 numCores, opts.parallel, opts.admitPolicy, opts.maxBypass);
 }
 
 //Output a usage message to cout if the user makes any mistake (or if they are just
 //trying to learn how to use the program.
 void usageAbort(string program) {
-	cout << "Usage: $ " << program << " -cq BASE QUEUENUM" << endl
+	cout << "Usage: $ " << program << " -cpq [-n CORES] [--admit POLICY [--reserve N]]"
+			" [--boost N] [--parallel]"
+			" [--follow FILE | --headless [--trace FILE] [--json FILE]]"
+			" [--restore FILE] [--checkpoint FILE [--checkpoint-every N]]"
+			" [--journal FILE [--journal-interval MS]] [--histograms FILE]"
+			" [--timeline FILE]"
+			" BASE QUEUENUM" << endl
 		 << "-q: Quanta differ such that higher priority queues get shorter slices"<< endl
 		 << "-c: \"smart\" slice allocation: A job's slice is multiplied by it's"  << endl
 		 << "    longest chain of dependents, allowing important jobs to get extra"<< endl
 		 << "    attention and attempting to increase overall throughput" 		   << endl
+		 << "-p: like -c, but chains are measured in jiffies of work (the critical"<< endl
+		 << "    path) in units of the job's own burst, not in jobs"			   << endl
+		 << "-n: number of simulated cores, each with its own MLFQ (default 1)"  << endl
+		 << "--parallel: every core processes its slices on its own worker thread"<< endl
+		 << "    while the scheduler keeps making decisions" 					   << endl
+		 << "--follow: keep adding the jobs written to FILE (a named pipe or a file"  << endl
+		 << "    that is appended to, one job per line) while the scheduler runs" << endl
+		 << "--admit: which job waiting on memory gets in next: fifo (default), "  << endl
+		 << "    first-fit (oldest that fits), or best-fit (biggest that fits)"    << endl
+		 << "--reserve: with first-fit or best-fit, admit nothing else once N jobs"<< endl
+		 << "    have gone ahead of the oldest waiting job (default: no limit)"    << endl
+		 << "--boost: every N jiffies, move every job back to the top priority so"<< endl
+		 << "    long jobs are not starved by short ones (default: never)"		   << endl
 		 << "BASE: quantum time (in jiffies) given to lowest priority jobs" 	   << endl
 		 << "QUEUENUM: number of priority levels (i.e. queues in the MLFQ algorithm"
-		 << endl << endl
+		 << endl
+		 << "--headless: no UI; load FILE (or stdin), run on a virtual clock until"  << endl
+		 << "    every job is done, then print the statistics (or write them to the"<< endl
+		 << "    --json FILE)" 													   << endl
+		 << "--restore: start from the state in a checkpoint FILE (same BASE,"	   << endl
+		 << "    QUEUENUM, -c, -p, -q and -n), then load the --trace FILE if"	   << endl
+		 << "    any"															   << endl
+		 << "--checkpoint: where s in the menu writes a checkpoint of the whole"   << endl
+		 << "    state, without stopping the scheduler; also every N jiffies with"<< endl
+		 << "    --checkpoint-every"											   << endl
+		 << "--journal: replay FILE on top of the state so far (after --restore),"  << endl
+		 << "    then log every job added, killed and completed to it, synced in"  << endl
+		 << "    batches every MS milliseconds (default 10; 0: as soon as possible)"<< endl
+		 << "--histograms: write latency, response, turnaround and slowdown"	   << endl
+		 << "    histograms (overall, per level and per burst size) to FILE as"	   << endl
+		 << "    JSON when done; also h in the menu"							   << endl
+		 << "--timeline: record every slice, demotion, admission, completion and"  << endl
+		 << "    dependency release (the last million per thread) and write them to"<< endl
+		 << "    FILE as a Chrome trace when done; t in the menu starts and stops"  << endl
+		 << "    tracing at any time"											   << endl
+		 << endl
 		 << "For more info see ReadMe and http://pages.cs.wisc.edu/~remzi/OSTEP/cpu-"
 		    "sched-mlfq.pdf" << endl;
 	exit(1);